@@ -50,6 +50,10 @@
 #include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <errno.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #include "ebizzy.h"
 
@@ -70,6 +74,31 @@ static unsigned int verbose;
 static unsigned int linear;
 static unsigned int touch_pages;
 static unsigned int no_lib_memcpy;
+static unsigned int interval_ms;
+static unsigned int latency;
+
+/*
+ * Allocators of the per-record copy buffer, -a.  malloc and mmap go to
+ * the C library and the kernel every record; arena and pool reuse
+ * per-thread memory, which takes allocation and page faults out of the
+ * loop and leaves the memcpy and search.
+ */
+
+enum {
+	COPY_MALLOC,
+	COPY_MMAP,
+	COPY_ARENA,
+	COPY_POOL,
+};
+
+static const char *copy_alloc_names[] = {
+	[COPY_MALLOC] = "malloc",
+	[COPY_MMAP] = "mmap",
+	[COPY_ARENA] = "arena",
+	[COPY_POOL] = "pool",
+};
+
+static unsigned int copy_alloc = COPY_MALLOC;
 
 /*
  * Other global variables
@@ -81,15 +110,70 @@ static char *cmd;
 static record_t **mem;
 static char **hole_mem;
 static unsigned int page_size;
-static time_t start_time;
-static volatile int threads_go;
-static unsigned int records_read;
+static struct timespec start_time;
+static pthread_barrier_t start_barrier;
+static int stop_threads;
+
+/*
+ * The stop flag is checked once every STOP_CHECK_RECORDS records, so
+ * the search loop does not touch the shared cache line every record.
+ */
+#define STOP_CHECK_RECORDS	8
+
+/*
+ * Per-phase latency of each record, -L.  A histogram is log-linear:
+ * values below HIST_SUB_BUCKETS are exact, above that every power of two
+ * is split into HIST_SUB_BUCKETS linear buckets, so percentiles are
+ * within 1/HIST_SUB_BUCKETS of the true value.
+ */
+
+enum {
+	PHASE_ALLOC,
+	PHASE_COPY,
+	PHASE_SEARCH,
+	PHASE_FREE,
+	PHASES,
+};
+
+static const char *phase_names[PHASES] = {
+	[PHASE_ALLOC] = "alloc",
+	[PHASE_COPY] = "copy",
+	[PHASE_SEARCH] = "search",
+	[PHASE_FREE] = "free",
+};
+
+#define HIST_SUB_BITS		4
+#define HIST_SUB_BUCKETS	(1 << HIST_SUB_BITS)
+#define HIST_BUCKETS		((64 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+struct histogram {
+	unsigned long long count;
+	unsigned long long max;
+	unsigned long long buckets[HIST_BUCKETS];
+};
+
+/*
+ * Per-thread state, padded to a cache line so that the counters of
+ * neighbouring threads do not share one.
+ */
+
+struct thread_info {
+	pthread_t thread;
+	unsigned long long records;
+	char *arena;		/* -a arena: bump region of chunk_size */
+	size_t arena_used;
+	void *pool;		/* -a pool: free list of chunk_size buffers */
+	struct histogram *hist;	/* -L: one per phase, in TSC cycles */
+} __attribute__((aligned(64)));
 
 static void usage(void)
 {
 	fprintf(stderr, "Usage: %s [options]\n"
 		"-T\t\t Just 'touch' the allocated pages\n"
+		"-a <alloc>\t Copy buffer allocator: malloc, mmap, arena or pool\n"
+		"-i <msec>\t Print records/s every msec\n"
 		"-l\t\t Don't use library memcpy\n"
+		"-L\t\t Report p50/p99/p99.9 latency of each record phase\n"
 		"-m\t\t Always use mmap instead of malloc\n"
 		"-M\t\t Never use mmap\n"
 		"-n <num>\t Number of memory chunks to allocate\n"
@@ -132,11 +216,30 @@ static void read_options(int argc, char *argv[])
 	cmd = argv[0];
 	opterr = 1;
 
-	while ((c = getopt(argc, argv, "lmMn:pPRs:S:t:vzT")) != -1) {
+	while ((c = getopt(argc, argv, "a:i:lLmMn:pPRs:S:t:vzT")) != -1) {
 		switch (c) {
+		case 'a':
+			for (copy_alloc = COPY_MALLOC; copy_alloc <= COPY_POOL;
+			     copy_alloc++)
+				if (strcmp(optarg, copy_alloc_names[copy_alloc]) == 0)
+					break;
+			if (copy_alloc > COPY_POOL)
+				usage();
+			/* -a mmap is the old -m */
+			if (copy_alloc == COPY_MMAP)
+				always_mmap = 1;
+			break;
+		case 'i':
+			interval_ms = atoi(optarg);
+			if (interval_ms == 0)
+				usage();
+			break;
 		case 'l':
 			no_lib_memcpy = 1;
 			break;
+		case 'L':
+			latency = 1;
+			break;
 		case 'm':
 			always_mmap = 1;
 			break;
@@ -186,6 +289,10 @@ static void read_options(int argc, char *argv[])
 		}
 	}
 
+	/* -m alone mmaps the copy buffer, with -a arena or pool it backs them */
+	if (always_mmap && copy_alloc == COPY_MALLOC)
+		copy_alloc = COPY_MMAP;
+
 	if (verbose)
 		printf("ebizzy 0.2\n"
 		       "(C) 2006-7 Intel Corporation\n"
@@ -205,6 +312,9 @@ static void read_options(int argc, char *argv[])
 		printf("verbose %u\n", verbose);
 		printf("linear %u\n", linear);
 		printf("touch_pages %u\n", touch_pages);
+		printf("interval_ms %u\n", interval_ms);
+		printf("copy allocator %s\n", copy_alloc_names[copy_alloc]);
+		printf("latency %u\n", latency);
 		printf("page size %d\n", page_size);
 	}
 
@@ -270,6 +380,72 @@ static void free_mem(void *p, size_t size)
 		free(p);
 }
 
+/*
+ * Allocate and free the copy buffer of one record with the -a
+ * allocator.  The arena hands out 64-byte aligned pieces of a per-thread
+ * region and is reset when the record is done; the pool keeps freed
+ * chunk_size buffers on a per-thread list.  Both get their memory from
+ * alloc_mem(), so -m still decides between malloc and mmap for them.
+ */
+
+static void *copy_alloc_mem(struct thread_info *ti, size_t size)
+{
+	void *p;
+
+	switch (copy_alloc) {
+	case COPY_ARENA:
+		if (ti->arena == NULL)
+			ti->arena = alloc_mem(chunk_size);
+		size = (size + 63) & ~(size_t)63;
+		if (ti->arena_used + size > chunk_size) {
+			fprintf(stderr, "Arena of %u bytes exhausted\n",
+				chunk_size);
+			exit(1);
+		}
+		p = ti->arena + ti->arena_used;
+		ti->arena_used += size;
+		return p;
+	case COPY_POOL:
+		if (ti->pool == NULL)
+			return alloc_mem(chunk_size);
+		p = ti->pool;
+		ti->pool = *(void **)p;
+		return p;
+	default:
+		return alloc_mem(size);
+	}
+}
+
+static void copy_free_mem(struct thread_info *ti, void *p, size_t size)
+{
+	switch (copy_alloc) {
+	case COPY_ARENA:
+		/* One record per arena, so freeing resets it */
+		ti->arena_used = 0;
+		break;
+	case COPY_POOL:
+		*(void **)p = ti->pool;
+		ti->pool = p;
+		break;
+	default:
+		free_mem(p, size);
+	}
+}
+
+/* Release what the arena and pool of a thread hold */
+
+static void copy_alloc_release(struct thread_info *ti)
+{
+	void *p;
+
+	if (ti->arena)
+		free_mem(ti->arena, chunk_size);
+	while ((p = ti->pool) != NULL) {
+		ti->pool = *(void **)p;
+		free_mem(p, chunk_size);
+	}
+}
+
 /*
  * Factor out differences in memcpy implementation by optionally using
  * our own simple memcpy implementation.
@@ -342,6 +518,84 @@ static int compare(const void *p1, const void *p2)
 	return (*(record_t *) p1 - *(record_t *) p2);
 }
 
+/*
+ * Timestamps of the -L phases, in TSC cycles where there is a TSC.
+ * Either way they are converted with a rate measured over the run.
+ */
+
+static inline unsigned long long read_tsc(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static void hist_add(struct histogram *h, unsigned long long v)
+{
+	int idx, msb;
+
+	if (v < HIST_SUB_BUCKETS) {
+		idx = v;
+	} else {
+		msb = 63 - __builtin_clzll(v);
+		idx = (msb - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS +
+		      ((v >> (msb - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1));
+	}
+
+	h->buckets[idx]++;
+	h->count++;
+	if (v > h->max)
+		h->max = v;
+}
+
+/* Smallest value of bucket idx, the inverse of hist_add() */
+
+static unsigned long long hist_value(int idx)
+{
+	int msb;
+
+	if (idx < HIST_SUB_BUCKETS)
+		return idx;
+
+	msb = idx / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+	return (1ULL << msb) |
+	       ((unsigned long long)(idx % HIST_SUB_BUCKETS) <<
+		(msb - HIST_SUB_BITS));
+}
+
+static unsigned long long hist_percentile(struct histogram *h, double pct)
+{
+	unsigned long long target, seen = 0;
+	int i;
+
+	if (h->count == 0)
+		return 0;
+
+	target = h->count * pct / 100;
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen > target)
+			return hist_value(i);
+	}
+	return h->max;
+}
+
+static void hist_merge(struct histogram *dst, struct histogram *src)
+{
+	int i;
+
+	for (i = 0; i < HIST_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+	dst->count += src->count;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
 /*
  * Stupid ranged random number function.  We don't care about quality.
  *
@@ -366,16 +620,22 @@ static inline unsigned int rand_num(unsigned int max, unsigned int *state)
  *
  */
 
-static unsigned int search_mem(void)
+static void search_mem(struct thread_info *ti)
 {
 	record_t key, *found;
 	record_t *src, *copy;
 	unsigned int chunk;
 	size_t copy_size = chunk_size;
-	unsigned int i;
+	unsigned long long i;
 	unsigned int state = 0;
+	unsigned long long t[PHASES + 1];
+	int phase;
+
+	for (i = 0;; i++) {
+		if (i % STOP_CHECK_RECORDS == 0 &&
+		    __atomic_load_n(&stop_threads, __ATOMIC_RELAXED))
+			break;
 
-	for (i = 0; threads_go == 1; i++) {
 		chunk = rand_num(chunks, &state);
 		src = mem[chunk];
 		/*
@@ -385,16 +645,24 @@ static unsigned int search_mem(void)
 		if (random_size)
 			copy_size = (rand_num(chunk_size / record_size, &state)
 				     + 1) * record_size;
-		copy = alloc_mem(copy_size);
+		if (latency)
+			t[PHASE_ALLOC] = read_tsc();
+		copy = copy_alloc_mem(ti, copy_size);
+		if (latency)
+			t[PHASE_COPY] = read_tsc();
 
 		if (touch_pages) {
 			touch_mem((char *)copy, copy_size);
+			if (latency)
+				t[PHASE_SEARCH] = read_tsc();
 		} else {
 
 			if (no_lib_memcpy)
 				my_memcpy(copy, src, copy_size);
 			else
 				memcpy(copy, src, copy_size);
+			if (latency)
+				t[PHASE_SEARCH] = read_tsc();
 
 			key = rand_num(copy_size / record_size, &state);
 
@@ -415,31 +683,125 @@ static unsigned int search_mem(void)
 			}
 		}		/* end if ! touch_pages */
 
-		free_mem(copy, copy_size);
+		if (latency)
+			t[PHASE_FREE] = read_tsc();
+		copy_free_mem(ti, copy, copy_size);
+
+		if (latency) {
+			t[PHASES] = read_tsc();
+			/* With -T the search phase times no work */
+			for (phase = 0; phase < PHASES; phase++)
+				hist_add(&ti->hist[phase],
+					 t[phase + 1] - t[phase]);
+		}
+
+		/* Published for the interval reporter */
+		__atomic_store_n(&ti->records, i + 1, __ATOMIC_RELAXED);
 	}
+}
 
-	return (i);
+static double seconds_since(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) +
+	       (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void timespec_add_ms(struct timespec *ts, unsigned int ms)
+{
+	ts->tv_sec += ms / 1000;
+	ts->tv_nsec += (ms % 1000) * 1000000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+static int timespec_before(struct timespec *a, struct timespec *b)
+{
+	return a->tv_sec < b->tv_sec ||
+	       (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static void sleep_until(struct timespec *deadline)
+{
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline,
+			       NULL) == EINTR)
+		;
 }
 
 static void *thread_run(void *arg)
 {
+	struct thread_info *ti = arg;
 
 	if (verbose > 1)
 		printf("Thread started\n");
 
-	/* Wait for the start signal */
+	/* Allocated here, so the histograms are local to the thread */
+	if (latency) {
+		ti->hist = calloc(PHASES, sizeof(*ti->hist));
+		if (ti->hist == NULL) {
+			fprintf(stderr, "Couldn't allocate histograms\n");
+			exit(1);
+		}
+	}
+
+	/* Sleep until all threads and the main thread are ready */
 
-	while (threads_go == 0) ;
+	pthread_barrier_wait(&start_barrier);
 
-	records_read += search_mem();
+	search_mem(ti);
+	copy_alloc_release(ti);
 
 	if (verbose > 1)
 		printf("Thread finished, %f seconds\n",
-		       difftime(time(NULL), start_time));
+		       seconds_since(&start_time));
 
 	return NULL;
 }
 
+/*
+ * Sleep for the length of the run.  With -i, wake up every interval
+ * and print the records/s of all threads since the previous one, so
+ * the warm-up transient can be told apart from the steady state.
+ */
+
+static void run_intervals(struct thread_info *thread_array)
+{
+	struct timespec end = start_time, deadline = start_time;
+	unsigned long long records, last_records = 0;
+	double now, last = 0;
+	unsigned int i;
+
+	end.tv_sec += seconds;
+
+	if (!interval_ms) {
+		sleep_until(&end);
+		return;
+	}
+
+	do {
+		timespec_add_ms(&deadline, interval_ms);
+		if (!timespec_before(&deadline, &end))
+			deadline = end;
+		sleep_until(&deadline);
+
+		now = seconds_since(&start_time);
+		records = 0;
+		for (i = 0; i < threads; i++)
+			records += __atomic_load_n(&thread_array[i].records,
+						   __ATOMIC_RELAXED);
+
+		printf("%8.3f s %llu records/s\n", now,
+		       (unsigned long long)((records - last_records) /
+					    (now - last)));
+		last_records = records;
+		last = now;
+	} while (timespec_before(&deadline, &end));
+}
+
 static struct timeval difftimeval(struct timeval *end, struct timeval *start)
 {
 	struct timeval diff;
@@ -448,10 +810,49 @@ static struct timeval difftimeval(struct timeval *end, struct timeval *start)
 	return diff;
 }
 
+/*
+ * Merge the per-thread histograms and print the percentiles of each
+ * phase in nanoseconds, converted with tsc_per_sec.
+ */
+
+static void report_latency(struct thread_info *thread_array,
+			   double tsc_per_sec)
+{
+	struct histogram *total;
+	double ns_per_tsc = 1e9 / tsc_per_sec;
+	unsigned int i;
+	int phase;
+
+	total = calloc(PHASES, sizeof(*total));
+	if (total == NULL) {
+		fprintf(stderr, "Couldn't allocate histograms\n");
+		exit(1);
+	}
+
+	for (i = 0; i < threads; i++) {
+		for (phase = 0; phase < PHASES; phase++)
+			hist_merge(&total[phase], &thread_array[i].hist[phase]);
+		free(thread_array[i].hist);
+	}
+
+	printf("tsc %.1f MHz\n", tsc_per_sec / 1e6);
+	for (phase = 0; phase < PHASES; phase++)
+		printf("%-6s p50 %.0f p99 %.0f p99.9 %.0f max %.0f ns\n",
+		       phase_names[phase],
+		       hist_percentile(&total[phase], 50) * ns_per_tsc,
+		       hist_percentile(&total[phase], 99) * ns_per_tsc,
+		       hist_percentile(&total[phase], 99.9) * ns_per_tsc,
+		       total[phase].max * ns_per_tsc);
+
+	free(total);
+}
+
 static void start_threads(void)
 {
-	pthread_t thread_array[threads];
+	struct thread_info *thread_array;
+	unsigned long long records_read = 0, min_records, max_records;
 	double elapsed;
+	unsigned long long start_tsc, end_tsc;
 	unsigned int i;
 	struct rusage start_ru, end_ru;
 	struct timeval usr_time, sys_time;
@@ -460,8 +861,21 @@ static void start_threads(void)
 	if (verbose)
 		printf("Threads starting\n");
 
+	err = pthread_barrier_init(&start_barrier, NULL, threads + 1);
+	if (err) {
+		fprintf(stderr, "Error creating start barrier\n");
+		exit(1);
+	}
+
+	thread_array = calloc(threads, sizeof(*thread_array));
+	if (thread_array == NULL) {
+		fprintf(stderr, "Couldn't allocate %u threads\n", threads);
+		exit(1);
+	}
+
 	for (i = 0; i < threads; i++) {
-		err = pthread_create(&thread_array[i], NULL, thread_run, NULL);
+		err = pthread_create(&thread_array[i].thread, NULL, thread_run,
+				     &thread_array[i]);
 		if (err) {
 			fprintf(stderr, "Error creating thread %d\n", i);
 			exit(1);
@@ -470,14 +884,17 @@ static void start_threads(void)
 
 	/*
 	 * Begin accounting - this is when we actually do the things
-	 * we want to measure. */
+	 * we want to measure.  The threads sleep in the barrier until
+	 * then, so thread start-up is not charged to the run. */
 
+	pthread_barrier_wait(&start_barrier);
 	getrusage(RUSAGE_SELF, &start_ru);
-	start_time = time(NULL);
-	threads_go = 1;
-	sleep(seconds);
-	threads_go = 0;
-	elapsed = difftime(time(NULL), start_time);
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	start_tsc = read_tsc();
+	run_intervals(thread_array);
+	__atomic_store_n(&stop_threads, 1, __ATOMIC_RELAXED);
+	elapsed = seconds_since(&start_time);
+	end_tsc = read_tsc();
 	getrusage(RUSAGE_SELF, &end_ru);
 
 	/*
@@ -485,7 +902,7 @@ static void start_threads(void)
 	 */
 
 	for (i = 0; i < threads; i++) {
-		err = pthread_join(thread_array[i], NULL);
+		err = pthread_join(thread_array[i].thread, NULL);
 		if (err) {
 			fprintf(stderr, "Error joining thread %d\n", i);
 			exit(1);
@@ -495,8 +912,26 @@ static void start_threads(void)
 	if (verbose)
 		printf("Threads finished\n");
 
-	printf("%u records/s\n",
-	       (unsigned int)(((double)records_read) / elapsed));
+	/* Reduce the per-thread counts now that nobody writes them */
+
+	min_records = max_records = thread_array[0].records;
+	for (i = 0; i < threads; i++) {
+		records_read += thread_array[i].records;
+		if (thread_array[i].records < min_records)
+			min_records = thread_array[i].records;
+		if (thread_array[i].records > max_records)
+			max_records = thread_array[i].records;
+	}
+
+	printf("%llu records/s\n",
+	       (unsigned long long)(((double)records_read) / elapsed));
+
+	for (i = 0; i < threads; i++)
+		printf("thread %u %llu records/s\n", i,
+		       (unsigned long long)(thread_array[i].records / elapsed));
+	printf("threads min %llu max %llu records/s\n",
+	       (unsigned long long)(min_records / elapsed),
+	       (unsigned long long)(max_records / elapsed));
 
 	usr_time = difftimeval(&end_ru.ru_utime, &start_ru.ru_utime);
 	sys_time = difftimeval(&end_ru.ru_stime, &start_ru.ru_stime);
@@ -504,6 +939,12 @@ static void start_threads(void)
 	printf("real %5.2f s\n", elapsed);
 	printf("user %5.2f s\n", usr_time.tv_sec + usr_time.tv_usec / 1e6);
 	printf("sys  %5.2f s\n", sys_time.tv_sec + sys_time.tv_usec / 1e6);
+
+	if (latency)
+		report_latency(thread_array, (end_tsc - start_tsc) / elapsed);
+
+	free(thread_array);
+	pthread_barrier_destroy(&start_barrier);
 }
 
 int main(int argc, char *argv[])
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * alloc.c - allocate workload buffers with a selectable page size policy
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <err.h>
+#include <sys/mman.h>
+#include "yogini.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT	26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB	(21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB	(30 << MAP_HUGE_SHIFT)
+#endif
+
+#define SIZE_2MB	(2UL * 1024 * 1024)
+
+static const char * const alloc_names[] = {
+	[ALLOC_MALLOC] = "malloc",
+	[ALLOC_4K] = "4k",
+	[ALLOC_THP] = "thp",
+	[ALLOC_2M] = "2m",
+	[ALLOC_1G] = "1g",
+};
+
+int alloc_policy = ALLOC_MALLOC;
+int alloc_populate;
+
+int parse_alloc_policy(const char *name)
+{
+	int i;
+
+	for (i = 0; i <= ALLOC_1G; i++) {
+		if (strcmp(name, alloc_names[i]) == 0) {
+			alloc_policy = i;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static size_t page_bytes(void)
+{
+	switch (alloc_policy) {
+	case ALLOC_2M:
+	case ALLOC_THP:
+		return SIZE_2MB;
+	case ALLOC_1G:
+		return SIZE_1GB;
+	default:
+		return getpagesize();
+	}
+}
+
+static size_t round_up(size_t bytes)
+{
+	size_t page = page_bytes();
+
+	return (bytes + page - 1) / page * page;
+}
+
+/* write one byte per 4K page so that every page is faulted in */
+static void touch_pages(char *p, size_t bytes)
+{
+	size_t i;
+
+	for (i = 0; i < bytes; i += getpagesize())
+		p[i] = 0;
+}
+
+/*
+ * alloc_buffer()
+ * allocate bytes backed by pages of alloc_policy,
+ * faulted in up front if alloc_populate is set
+ */
+void *alloc_buffer(size_t bytes)
+{
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	void *p;
+
+	switch (alloc_policy) {
+	case ALLOC_MALLOC:
+		/* cache line aligned for the aligned and non-temporal copy kernels */
+		if (posix_memalign(&p, 64, bytes))
+			errx(1, "malloc %zu bytes failed", bytes);
+		if (alloc_populate)
+			touch_pages(p, bytes);
+		return p;
+	case ALLOC_THP:
+		p = aligned_alloc(SIZE_2MB, round_up(bytes));
+		if (!p)
+			err(1, "aligned_alloc %zu bytes", bytes);
+		if (madvise(p, round_up(bytes), MADV_HUGEPAGE))
+			warn("madvise MADV_HUGEPAGE");
+		if (alloc_populate)
+			touch_pages(p, bytes);
+		return p;
+	case ALLOC_2M:
+		flags |= MAP_HUGETLB | MAP_HUGE_2MB;
+		break;
+	case ALLOC_1G:
+		flags |= MAP_HUGETLB | MAP_HUGE_1GB;
+		break;
+	}
+
+	/* 4K pages are faulted in after MADV_NOHUGEPAGE, not by MAP_POPULATE */
+	if (alloc_populate && alloc_policy != ALLOC_4K)
+		flags |= MAP_POPULATE;
+
+	p = mmap(NULL, round_up(bytes), PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (p == MAP_FAILED)
+		err(1, "mmap %zu bytes with %s pages%s", bytes, alloc_names[alloc_policy],
+		    alloc_policy == ALLOC_4K ? "" : ", check /proc/sys/vm/nr_hugepages");
+
+	if (alloc_policy == ALLOC_4K) {
+		if (madvise(p, round_up(bytes), MADV_NOHUGEPAGE))
+			warn("madvise MADV_NOHUGEPAGE");
+		if (alloc_populate)
+			touch_pages(p, bytes);
+	}
+
+	return p;
+}
+
+void free_buffer(void *p, size_t bytes)
+{
+	if (alloc_policy == ALLOC_MALLOC || alloc_policy == ALLOC_THP)
+		free(p);
+	else
+		munmap(p, round_up(bytes));
+}
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * generic AMX code for re-use via inclusion
+ *
+ * Copyright (c) 2022 Intel Corporation.
+ * Yi Sun <yi.sun@intel.com>
+ * Dongcheng Yan <dongcheng.yan@intel.com>
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <immintrin.h>
+
+#define XFEATURE_XTILEDATA 18
+#define ARCH_REQ_XCOMP_PERM 0x1023
+
+struct __tile_config {
+	uint8_t palette_id;
+	uint8_t start_row;
+	uint8_t reserved_0[14];
+	uint16_t colsb[8];
+	uint16_t reserved_1[8];
+	uint8_t rows[8];
+	uint8_t reserved_2[8];
+};
+
+union __union_tile_config {
+	struct __tile_config s;
+	uint8_t a[64];
+};
+
+static KERNEL void init_tile_config(union __union_tile_config *dst, uint8_t rows, uint8_t colsb)
+{
+	int32_t i;
+
+	dst->s.palette_id = 1;
+	dst->s.start_row = 0;
+
+	for (i = 0; i < 14; i++)
+		dst->s.reserved_0[i] = 0;
+
+	for (i = 0; i < 8; i++) {
+		dst->s.reserved_1[i] = 0;
+		dst->s.reserved_2[i] = 0;
+	}
+
+	for (i = 0; i < 8; i++) {
+		dst->s.colsb[i] = colsb;
+		dst->s.rows[i] = rows;
+	}
+
+	_tile_loadconfig(dst->a);
+}
+
+/* Set_tiledata_use() - Invoke syscall to set ARCH_SET_STATE_USE */
+static void set_tiledata_use(void)
+{
+	if (syscall(SYS_arch_prctl, ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA))
+		printf("Fail to do XFEATURE_XTILEDATA\n");
+}
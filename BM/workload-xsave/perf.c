@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * perf.c - per-worker hardware performance counters
+ *
+ * Every worker opens one perf event group on itself, and reads it around
+ * run() with rdpmc through the mmap'ed event page, or with read(2) when
+ * the kernel does not allow user space rdpmc or the event is not on a
+ * counter at that moment.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <err.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "yogini.h"
+
+#define PERF_RAW_MAX	4
+
+static struct {
+	const char *name;
+	__u32 type;
+	__u64 config;
+} perf_events[PERF_EVENTS_MAX] = {
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "ref-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES },
+	{ "L1D-read-misses", PERF_TYPE_HW_CACHE,
+	  PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ "LLC-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+};
+
+int perf_enabled;
+int perf_nr_events = 5;
+
+/* names of the --perf_raw events, "raw-0x..." */
+static char raw_names[PERF_RAW_MAX][24];
+
+/* count kernel time too, unless perf_event_paranoid forbids it */
+static int exclude_kernel;
+
+/*
+ * parse_perf_raw()
+ * add a comma separated list of raw event codes, e.g. 0x18c4,0x20d1
+ * return 0 on success, -1 if malformed or too many
+ */
+int parse_perf_raw(const char *list)
+{
+	unsigned long long config;
+	const char *p = list;
+	char *end;
+	int raw;
+
+	while (*p) {
+		raw = perf_nr_events - (PERF_EVENTS_MAX - PERF_RAW_MAX);
+		if (raw >= PERF_RAW_MAX)
+			return -1;
+
+		config = strtoull(p, &end, 0);
+		if (end == p || (*end && *end != ','))
+			return -1;
+
+		snprintf(raw_names[raw], sizeof(raw_names[raw]), "raw-0x%llx", config);
+		perf_events[perf_nr_events].name = raw_names[raw];
+		perf_events[perf_nr_events].type = PERF_TYPE_RAW;
+		perf_events[perf_nr_events].config = config;
+		perf_nr_events++;
+
+		p = *end ? end + 1 : end;
+	}
+
+	return 0;
+}
+
+const char *perf_event_name(int idx)
+{
+	return perf_events[idx].name;
+}
+
+static int perf_event_open(struct perf_event_attr *attr, int group_fd)
+{
+	return syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0);
+}
+
+/* what read(2) returns for an event, see perf_open() */
+struct perf_read_format {
+	unsigned long long value;
+	unsigned long long time_enabled;
+	unsigned long long time_running;
+};
+
+/*
+ * perf_open()
+ * open the events on the calling thread, grouped under cycles.
+ * An event that does not fit the group, e.g. more events than
+ * general purpose counters, is opened as a leader of its own.
+ * Events the CPU or kernel do not support stay at fd -1 and read as 0.
+ * return 0, or -1 with nothing left open if cycles itself fails,
+ * which leaves the other workers' groups alone
+ */
+int perf_open(struct perf_set *ps)
+{
+	struct perf_event_attr attr;
+	int i, group_fd = -1;
+
+	for (i = 0; i < PERF_EVENTS_MAX; i++) {
+		ps->fd[i] = -1;
+		ps->page[i] = NULL;
+		ps->start[i] = 0;
+	}
+
+	for (i = 0; i < perf_nr_events; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = perf_events[i].type;
+		attr.config = perf_events[i].config;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+				   PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.exclude_hv = 1;
+		attr.exclude_kernel = __atomic_load_n(&exclude_kernel, __ATOMIC_RELAXED);
+
+		ps->fd[i] = perf_event_open(&attr, group_fd);
+		if (ps->fd[i] < 0 && (errno == EACCES || errno == EPERM) && !attr.exclude_kernel) {
+			__atomic_store_n(&exclude_kernel, 1, __ATOMIC_RELAXED);
+			attr.exclude_kernel = 1;
+			ps->fd[i] = perf_event_open(&attr, group_fd);
+		}
+		if (ps->fd[i] < 0 && group_fd >= 0)
+			ps->fd[i] = perf_event_open(&attr, -1);
+		if (ps->fd[i] < 0) {
+			if (i == 0) {
+				warn("perf: %s, no counters for this worker", perf_events[i].name);
+				return -1;
+			}
+			continue;
+		}
+		if (i == 0)
+			group_fd = ps->fd[i];
+
+		ps->page[i] = mmap(NULL, getpagesize(), PROT_READ, MAP_SHARED, ps->fd[i], 0);
+		if (ps->page[i] == MAP_FAILED)
+			ps->page[i] = NULL;
+	}
+
+	return 0;
+}
+
+static unsigned long long rdpmc(unsigned int counter)
+{
+	unsigned int low, high;
+
+	asm volatile("rdpmc" : "=a" (low), "=d" (high) : "c" (counter));
+
+	return low | (unsigned long long)high << 32;
+}
+
+/*
+ * perf_read()
+ * read event i with rdpmc while it sits on a counter of this CPU,
+ * else with read(2)
+ */
+static unsigned long long perf_read(struct perf_set *ps, int i)
+{
+	struct perf_event_mmap_page *pc = ps->page[i];
+	struct perf_read_format rf;
+	unsigned long long count;
+	unsigned int seq, idx, width;
+	long long pmc;
+
+	if (ps->fd[i] < 0)
+		return 0;
+
+	if (pc) {
+		do {
+			seq = pc->lock;
+			__atomic_signal_fence(__ATOMIC_SEQ_CST);
+			idx = pc->index;
+			count = pc->offset;
+			if (!pc->cap_user_rdpmc || !idx)
+				break;
+			width = pc->pmc_width;
+			/* sign extend the counter, pc->offset assumes it */
+			pmc = rdpmc(idx - 1) << (64 - width);
+			count += pmc >> (64 - width);
+			__atomic_signal_fence(__ATOMIC_SEQ_CST);
+		} while (pc->lock != seq);
+
+		if (pc->cap_user_rdpmc && idx)
+			return count;
+	}
+
+	if (read(ps->fd[i], &rf, sizeof(rf)) != sizeof(rf))
+		return 0;
+
+	return rf.value;
+}
+
+void perf_begin(struct perf_set *ps)
+{
+	int i;
+
+	for (i = 0; i < perf_nr_events; i++)
+		ps->start[i] = perf_read(ps, i);
+}
+
+void perf_end(struct perf_set *ps, unsigned long long *counts)
+{
+	int i;
+
+	for (i = 0; i < perf_nr_events; i++)
+		counts[i] = perf_read(ps, i) - ps->start[i];
+}
+
+/*
+ * perf_check()
+ * warn about events of wi that were not on a counter for all the time
+ * they were enabled, so that their counts are partial or 0
+ */
+void perf_check(struct perf_set *ps, struct work_instance *wi)
+{
+	struct perf_read_format rf;
+	int i;
+
+	for (i = 0; i < perf_nr_events; i++) {
+		if (ps->fd[i] < 0 || read(ps->fd[i], &rf, sizeof(rf)) != sizeof(rf))
+			continue;
+		if (rf.time_running < rf.time_enabled)
+			warnx("Thread %d:%s perf: %s counted %.0f%% of the time, "
+			      "more events than counters?", wi->thread_number,
+			      wi->workload->name, perf_events[i].name,
+			      100.0 * rf.time_running / rf.time_enabled);
+	}
+}
+
+void perf_close(struct perf_set *ps)
+{
+	int i;
+
+	for (i = 0; i < perf_nr_events; i++) {
+		if (ps->page[i])
+			munmap(ps->page[i], getpagesize());
+		if (ps->fd[i] >= 0)
+			close(ps->fd[i]);
+	}
+}
+
+/*
+ * perf_print()
+ * print the counts of wi, with IPC and the ratio of core cycles to TSC
+ * cycles, which is the average frequency relative to the TSC frequency
+ */
+void perf_print(struct work_instance *wi)
+{
+	unsigned long long *c = wi->perf_count;
+	int i;
+
+	printf("Thread %d:%s perf", wi->thread_number, wi->workload->name);
+	for (i = 0; i < perf_nr_events; i++)
+		printf(" %s %llu", perf_events[i].name, c[i]);
+	if (c[0])
+		printf(" IPC %.2f", (double)c[1] / c[0]);
+	if (wi->cycles)
+		printf(" cycles/TSC %.3f", (double)c[0] / wi->cycles);
+	printf("\n");
+}
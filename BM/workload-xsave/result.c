@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * result.c - write per-worker results in a machine-readable format
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include "yogini.h"
+
+enum {
+	RESULT_JSON,
+	RESULT_CSV,
+};
+
+static FILE *result_fp;
+static int result_format;
+static int result_records;
+/* perf_<event> columns, fixed at open; "cycles" alone is the TSC */
+static int result_perf;
+/* ns/elem statistics of --trials */
+static int result_trials;
+
+/*
+ * result_open()
+ * open path for results in format "json" or "csv"
+ * return 0 on success, -1 on unknown format
+ */
+int result_open(const char *path, const char *format)
+{
+	int i;
+
+	if (!format || strcmp(format, "json") == 0)
+		result_format = RESULT_JSON;
+	else if (strcmp(format, "csv") == 0)
+		result_format = RESULT_CSV;
+	else
+		return -1;
+
+	result_perf = perf_enabled;
+	result_trials = trial_count > 1;
+	result_fp = fopen(path, "w");
+	if (!result_fp)
+		err(1, "%s", path);
+
+	if (result_format == RESULT_JSON) {
+		fprintf(result_fp, "[");
+	} else {
+		fprintf(result_fp, "workload,thread,break_reason,repeat,wi_bytes,bytes,cycles,ops,ops_per_sec,cpu,ns_per_op,elems_per_op,ns_per_elem,gbytes_per_sec,gops_per_sec");
+		if (result_trials)
+			fprintf(result_fp, ",trials,outliers,ns_mean,ns_stddev,ns_min,ns_median");
+		for (i = 0; result_perf && i < perf_nr_events; i++)
+			fprintf(result_fp, ",perf_%s", perf_event_name(i));
+		fprintf(result_fp, "\n");
+	}
+
+	return 0;
+}
+
+void result_write(struct work_instance *wi)
+{
+	double ops_per_sec = wi->seconds ? wi->ops / wi->seconds : 0;
+	int i;
+
+	if (!result_fp)
+		return;
+
+	if (result_format == RESULT_JSON) {
+		fprintf(result_fp, "%s\n  {\"workload\": \"%s\", \"thread\": %d, "
+			"\"break_reason\": \"%s\", \"repeat\": %u, \"wi_bytes\": %llu, \"bytes\": %llu, "
+			"\"cycles\": %llu, \"ops\": %llu, \"ops_per_sec\": %.1f, \"cpu\": %d, "
+			"\"ns_per_op\": %.3f, \"elems_per_op\": %llu, \"ns_per_elem\": %.3f, "
+			"\"gbytes_per_sec\": %.3f, \"gops_per_sec\": %.3f",
+			result_records ? "," : "", wi->workload->name, wi->thread_number,
+			break_reason_name(wi->break_reason), wi->repeat, wi->wi_bytes,
+			wi->ops * wi->op_bytes, wi->cycles, wi->ops, ops_per_sec, wi->last_cpu,
+			wi->ns_per_op, wi->op_elems ? wi->op_elems : 1, wi->ns_per_elem,
+			wi->gbytes_per_sec, wi->gops_per_sec);
+		if (result_trials)
+			fprintf(result_fp, ", \"trials\": %d, \"outliers\": %d, \"ns_mean\": %.3f, "
+				"\"ns_stddev\": %.3f, \"ns_min\": %.3f, \"ns_median\": %.3f",
+				wi->trials.count, wi->trials.outliers, wi->trials.mean,
+				wi->trials.stddev, wi->trials.min, wi->trials.median);
+		for (i = 0; result_perf && i < perf_nr_events; i++)
+			fprintf(result_fp, ", \"perf_%s\": %llu", perf_event_name(i), wi->perf_count[i]);
+		fprintf(result_fp, "}");
+	} else {
+		fprintf(result_fp, "%s,%d,%s,%u,%llu,%llu,%llu,%llu,%.1f,%d,%.3f,%llu,%.3f,%.3f,%.3f",
+			wi->workload->name, wi->thread_number,
+			break_reason_name(wi->break_reason), wi->repeat, wi->wi_bytes,
+			wi->ops * wi->op_bytes, wi->cycles, wi->ops, ops_per_sec, wi->last_cpu,
+			wi->ns_per_op, wi->op_elems ? wi->op_elems : 1, wi->ns_per_elem,
+			wi->gbytes_per_sec, wi->gops_per_sec);
+		if (result_trials)
+			fprintf(result_fp, ",%d,%d,%.3f,%.3f,%.3f,%.3f",
+				wi->trials.count, wi->trials.outliers, wi->trials.mean,
+				wi->trials.stddev, wi->trials.min, wi->trials.median);
+		for (i = 0; result_perf && i < perf_nr_events; i++)
+			fprintf(result_fp, ",%llu", wi->perf_count[i]);
+		fprintf(result_fp, "\n");
+	}
+	result_records++;
+}
+
+void result_close(void)
+{
+	if (!result_fp)
+		return;
+
+	if (result_format == RESULT_JSON)
+		fprintf(result_fp, "\n]\n");
+
+	fclose(result_fp);
+	result_fp = NULL;
+}
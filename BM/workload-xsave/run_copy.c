@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * generic copy worker code for re-use via inclusion
+ *
+ * The including file defines WORKLOAD_NAME and provides
+ * copy(dst, src, bytes) for MEM_BYTES_PER_ITERATION aligned blocks.
+ *
+ * Copyright (c) 2022 Intel Corporation.
+ * Len Brown <len.brown@intel.com>
+ * Yi Sun <yi.sun@intel.com>
+ * Dongcheng Yan <dongcheng.yan@intel.com>
+ *
+ */
+
+#include <stdlib.h>
+#include <err.h>
+#include <stdint.h>
+#include "yogini.h"
+
+void thread_break(int32_t reason, uint32_t thread_idx);
+#define MEM_BYTES_PER_ITERATION (4 * 1024)
+
+struct thread_data {
+	char *buf1;
+	char *buf2;
+};
+
+static int init(struct work_instance *wi)
+{
+	struct thread_data *dp;
+
+	dp = (struct thread_data *)calloc(1, sizeof(struct thread_data));
+	if (!dp)
+		err(1, "thread_data");
+
+	if (wi->wi_bytes % (2 * MEM_BYTES_PER_ITERATION)) {
+		warnx("%s: %llu bytes is invalid working set size.\n", WORKLOAD_NAME, wi->wi_bytes);
+		errx(-1, "%s: requires multiple of %d KB.\n", WORKLOAD_NAME,
+		     (2 * MEM_BYTES_PER_ITERATION) / 1024);
+	}
+
+	dp->buf1 = alloc_buffer(wi->wi_bytes / 2);
+	dp->buf2 = alloc_buffer(wi->wi_bytes / 2);
+
+	wi->worker_data = dp;
+	wi->op_bytes = MEM_BYTES_PER_ITERATION;
+	/* cache lines copied */
+	wi->op_elems = MEM_BYTES_PER_ITERATION / 64;
+
+	return 0;
+}
+
+static int cleanup(struct work_instance *wi)
+{
+	struct thread_data *dp = wi->worker_data;
+
+	free_buffer(dp->buf1, wi->wi_bytes / 2);
+	free_buffer(dp->buf2, wi->wi_bytes / 2);
+	free(dp);
+
+	wi->worker_data = NULL;
+
+	return 0;
+}
+
+/*
+ * run()
+ * copy bytes_to_copy, or until stop_workers is set
+ * return the TSC at the end
+ * copy from buf1 to buf2 in MEM_BYTES_PER_ITERATION blocks
+ */
+static unsigned long long run(struct work_instance *wi)
+{
+	char *src, *dst;
+	unsigned long long bytes_done;
+	unsigned long long bytes_to_copy = wi->repeat * MEM_BYTES_PER_ITERATION;
+	struct thread_data *dp = wi->worker_data;
+
+	src = dp->buf1;
+	dst = dp->buf2;
+
+	for (bytes_done = 0;;) {
+		int kb;
+
+		for (kb = 0; kb < wi->wi_bytes / 1024 / 2; kb += 4) {
+			copy(dst + kb * 1024, src + kb * 1024, MEM_BYTES_PER_ITERATION);
+
+			bytes_done += MEM_BYTES_PER_ITERATION;
+
+			thread_break(wi->break_reason, wi->thread_number);
+			if (worker_progress(wi, bytes_done / MEM_BYTES_PER_ITERATION))
+				goto done;
+			if (bytes_to_copy && bytes_done >= bytes_to_copy)
+				goto done;
+		}
+	}
+done:
+	return rdtsc();
+}
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * generic peak throughput worker code for re-use via inclusion
+ *
+ * The including file defines WORKLOAD_NAME, the vector type VEC with
+ * VEC_ZERO(), VEC_ADD(), VEC_STORE() and VEC_SET1_8/16() on integers,
+ * DOT(acc, x, y, ones) to multiply-add bytes x and y into dwords of acc
+ * in place,
+ * OPS_PER_VEC arithmetic operations done by one DOT(),
+ * PEAK_VEC_PER_CYCLE DOT()s the core can retire per cycle, and
+ * PEAK_VEC_REGS vector registers of VEC with PEAK_FIXED_REGS of them
+ * taken by the operands and the scratch of DOT().
+ *
+ * Unlike the entry loops of the base workloads, which wait on a load and
+ * on a single dependency chain, the operands stay in registers and
+ * --accumulators independent chains hide the DOT() latency, so the
+ * kernel runs at the port throughput of the instruction.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#include <stdlib.h>
+#include <err.h>
+#include <stdint.h>
+#include "yogini.h"
+
+/* DOT()s per accumulator in one operation */
+#define PEAK_ITERATIONS		1024
+
+/* a spilled accumulator adds a load and a store to its chain */
+_Static_assert(ACCUMULATORS_MAX + PEAK_FIXED_REGS <= PEAK_VEC_REGS,
+	       WORKLOAD_NAME " accumulators do not fit in registers");
+
+struct thread_data {
+	VEC x;
+	VEC y;
+	VEC ones;
+	VEC sink;		/* keeps the sums from being optimized out */
+};
+
+/*
+ * peak_<n>()
+ * n accumulator chains, each its own named variable so that gcc keeps
+ * it in one register; the chains k >= n are compiled out
+ */
+#define PEAK_DOT(n, k)		do { if ((k) < (n)) DOT(acc##k, x, y, ones); } while (0)
+#define PEAK_SUM(n, k)		do { if ((k) < (n)) acc0 = VEC_ADD(acc0, acc##k); } while (0)
+
+#define DEFINE_PEAK(n)								\
+static KERNEL void peak_##n(struct thread_data *dp)				\
+{										\
+	VEC x = dp->x, y = dp->y, ones = dp->ones;				\
+	VEC acc0 = VEC_ZERO(), acc1 = VEC_ZERO(), acc2 = VEC_ZERO();		\
+	VEC acc3 = VEC_ZERO(), acc4 = VEC_ZERO(), acc5 = VEC_ZERO();		\
+	VEC acc6 = VEC_ZERO(), acc7 = VEC_ZERO(), acc8 = VEC_ZERO();		\
+	VEC acc9 = VEC_ZERO(), acc10 = VEC_ZERO(), acc11 = VEC_ZERO();		\
+	int i;									\
+										\
+	(void)ones;		/* used by DOTPROD only */			\
+	for (i = 0; i < PEAK_ITERATIONS; i++) {					\
+		PEAK_DOT(n, 0);							\
+		PEAK_DOT(n, 1);							\
+		PEAK_DOT(n, 2);							\
+		PEAK_DOT(n, 3);							\
+		PEAK_DOT(n, 4);							\
+		PEAK_DOT(n, 5);							\
+		PEAK_DOT(n, 6);							\
+		PEAK_DOT(n, 7);							\
+		PEAK_DOT(n, 8);							\
+		PEAK_DOT(n, 9);							\
+		PEAK_DOT(n, 10);						\
+		PEAK_DOT(n, 11);						\
+	}									\
+										\
+	PEAK_SUM(n, 1);								\
+	PEAK_SUM(n, 2);								\
+	PEAK_SUM(n, 3);								\
+	PEAK_SUM(n, 4);								\
+	PEAK_SUM(n, 5);								\
+	PEAK_SUM(n, 6);								\
+	PEAK_SUM(n, 7);								\
+	PEAK_SUM(n, 8);								\
+	PEAK_SUM(n, 9);								\
+	PEAK_SUM(n, 10);							\
+	PEAK_SUM(n, 11);							\
+	VEC_STORE(&dp->sink, acc0);						\
+}
+
+DEFINE_PEAK(4)
+DEFINE_PEAK(5)
+DEFINE_PEAK(6)
+DEFINE_PEAK(7)
+DEFINE_PEAK(8)
+DEFINE_PEAK(9)
+DEFINE_PEAK(10)
+DEFINE_PEAK(11)
+DEFINE_PEAK(12)
+
+static void (*peak_kernels[ACCUMULATORS_MAX + 1])(struct thread_data *dp) = {
+	[4] = peak_4,
+	[5] = peak_5,
+	[6] = peak_6,
+	[7] = peak_7,
+	[8] = peak_8,
+	[9] = peak_9,
+	[10] = peak_10,
+	[11] = peak_11,
+	[12] = peak_12,
+};
+
+static KERNEL void work(void *arg)
+{
+	peak_kernels[accumulators]((struct thread_data *)arg);
+}
+
+/* small operands, so saturating DOT()s do not saturate */
+static KERNEL void set_operands(struct thread_data *dp)
+{
+	dp->x = VEC_SET1_8(1);
+	dp->y = VEC_SET1_8(1);
+	dp->ones = VEC_SET1_16(1);
+	dp->sink = VEC_ZERO();
+}
+
+static int init(struct work_instance *wi)
+{
+	struct thread_data *dp;
+
+	dp = aligned_alloc(64, sizeof(struct thread_data));
+	if (!dp)
+		err(1, "thread_data");
+
+	set_operands(dp);
+
+	wi->worker_data = dp;
+	wi->op_flops = (unsigned long long)PEAK_ITERATIONS * accumulators * OPS_PER_VEC;
+	wi->op_elems = (unsigned long long)PEAK_ITERATIONS * accumulators;
+	wi->op_integer = 1;
+
+	return 0;
+}
+
+/*
+ * cleanup()
+ * report ops per cycle against the port limit, per core cycle
+ * with --perf, else per TSC cycle
+ */
+static int cleanup(struct work_instance *wi)
+{
+	int core_cycles = wi->perf_active && wi->perf_count[0];
+	unsigned long long cycles = core_cycles ? wi->perf_count[0] : wi->cycles;
+	double peak = PEAK_VEC_PER_CYCLE * OPS_PER_VEC;
+	double achieved = cycles ? (double)wi->ops * wi->op_flops / cycles : 0;
+
+	printf("Thread %d:%s %d accumulators: %.1f ops per %s cycle, peak %.0f (%.0f%%)\n",
+	       wi->thread_number, WORKLOAD_NAME, accumulators, achieved,
+	       core_cycles ? "core" : "TSC", peak, achieved * 100 / peak);
+
+	free(wi->worker_data);
+	wi->worker_data = NULL;
+
+	return 0;
+}
+
+#include "run_common.c"
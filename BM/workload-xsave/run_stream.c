@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * generic STREAM worker code for re-use via inclusion
+ *
+ * The including file defines WORKLOAD_NAME and the vector type and
+ * operations on doubles: VEC, VEC_LOAD, VEC_STORE, VEC_ADD, VEC_MUL,
+ * VEC_SET1 and VEC_ZERO, with aligned loads and stores.
+ *
+ * Every worker streams through its own arrays a[], b[] and c[], which
+ * split the working set in three, in STREAM_BLOCK_BYTES blocks.
+ * One operation is one block of the kernel selected by --stream_kernel.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#include <stdlib.h>
+#include <err.h>
+#include <stdint.h>
+#include "yogini.h"
+
+void thread_break(int32_t reason, uint32_t thread_idx);
+#define STREAM_BLOCK_BYTES	(4 * 1024)
+#define STREAM_BLOCK_ENTRIES	(STREAM_BLOCK_BYTES / sizeof(double))
+#define VEC_ENTRIES		(sizeof(VEC) / sizeof(double))
+#define STREAM_SCALAR		3.0
+
+struct thread_data {
+	double *a;
+	double *b;
+	double *c;
+	size_t array_bytes;
+	double sink;		/* keeps the read kernel from being optimized out */
+};
+
+static int init(struct work_instance *wi)
+{
+	struct thread_data *dp;
+	size_t i;
+
+	dp = (struct thread_data *)calloc(1, sizeof(struct thread_data));
+	if (!dp)
+		err(1, "thread_data");
+
+	dp->array_bytes = wi->wi_bytes / 3 / STREAM_BLOCK_BYTES * STREAM_BLOCK_BYTES;
+	if (!dp->array_bytes)
+		errx(-1, "%s: requires at least %d KB.\n", WORKLOAD_NAME,
+		     3 * STREAM_BLOCK_BYTES / 1024);
+
+	dp->a = alloc_buffer(dp->array_bytes);
+	dp->b = alloc_buffer(dp->array_bytes);
+	dp->c = alloc_buffer(dp->array_bytes);
+
+	for (i = 0; i < dp->array_bytes / sizeof(double); i++) {
+		dp->a[i] = 1.0;
+		dp->b[i] = 2.0;
+		dp->c[i] = 0.0;
+	}
+
+	wi->worker_data = dp;
+	wi->op_bytes = (unsigned long long)stream_arrays(stream_kernel) * STREAM_BLOCK_BYTES;
+	/* doubles of one array, the loop count of the kernel */
+	wi->op_elems = STREAM_BLOCK_ENTRIES;
+
+	return 0;
+}
+
+static int cleanup(struct work_instance *wi)
+{
+	struct thread_data *dp = wi->worker_data;
+
+	free_buffer(dp->a, dp->array_bytes);
+	free_buffer(dp->b, dp->array_bytes);
+	free_buffer(dp->c, dp->array_bytes);
+	free(dp);
+
+	wi->worker_data = NULL;
+
+	return 0;
+}
+
+/* sum a[] */
+static KERNEL double stream_read(const double *a)
+{
+	VEC sum = VEC_ZERO();
+	double out[VEC_ENTRIES], total = 0;
+	size_t i;
+
+	for (i = 0; i < STREAM_BLOCK_ENTRIES; i += VEC_ENTRIES)
+		sum = VEC_ADD(sum, VEC_LOAD(a + i));
+
+	VEC_STORE(out, sum);
+	for (i = 0; i < VEC_ENTRIES; i++)
+		total += out[i];
+
+	return total;
+}
+
+/* a[] = s */
+static KERNEL void stream_write(double *a)
+{
+	VEC s = VEC_SET1(STREAM_SCALAR);
+	size_t i;
+
+	for (i = 0; i < STREAM_BLOCK_ENTRIES; i += VEC_ENTRIES)
+		VEC_STORE(a + i, s);
+}
+
+/* c[] = a[] */
+static KERNEL void stream_copy(double *c, const double *a)
+{
+	size_t i;
+
+	for (i = 0; i < STREAM_BLOCK_ENTRIES; i += VEC_ENTRIES)
+		VEC_STORE(c + i, VEC_LOAD(a + i));
+}
+
+/* b[] = s * c[] */
+static KERNEL void stream_scale(double *b, const double *c)
+{
+	VEC s = VEC_SET1(STREAM_SCALAR);
+	size_t i;
+
+	for (i = 0; i < STREAM_BLOCK_ENTRIES; i += VEC_ENTRIES)
+		VEC_STORE(b + i, VEC_MUL(s, VEC_LOAD(c + i)));
+}
+
+/* c[] = a[] + b[] */
+static KERNEL void stream_add(double *c, const double *a, const double *b)
+{
+	size_t i;
+
+	for (i = 0; i < STREAM_BLOCK_ENTRIES; i += VEC_ENTRIES)
+		VEC_STORE(c + i, VEC_ADD(VEC_LOAD(a + i), VEC_LOAD(b + i)));
+}
+
+/* a[] = b[] + s * c[] */
+static KERNEL void stream_triad(double *a, const double *b, const double *c)
+{
+	VEC s = VEC_SET1(STREAM_SCALAR);
+	size_t i;
+
+	for (i = 0; i < STREAM_BLOCK_ENTRIES; i += VEC_ENTRIES)
+		VEC_STORE(a + i, VEC_ADD(VEC_LOAD(b + i), VEC_MUL(s, VEC_LOAD(c + i))));
+}
+
+/*
+ * run()
+ * run the stream_kernel on wi->repeat blocks, or until stop_workers
+ * is set, wrapping around the arrays
+ * return the TSC at the end
+ */
+static unsigned long long run(struct work_instance *wi)
+{
+	struct thread_data *dp = wi->worker_data;
+	size_t entries = dp->array_bytes / sizeof(double);
+	unsigned long long count;
+	size_t i = 0;
+
+	for (count = 0; !wi->repeat || count < wi->repeat; count++) {
+		switch (stream_kernel) {
+		case STREAM_READ:
+			dp->sink += stream_read(dp->a + i);
+			break;
+		case STREAM_WRITE:
+			stream_write(dp->a + i);
+			break;
+		case STREAM_COPY:
+			stream_copy(dp->c + i, dp->a + i);
+			break;
+		case STREAM_SCALE:
+			stream_scale(dp->b + i, dp->c + i);
+			break;
+		case STREAM_ADD:
+			stream_add(dp->c + i, dp->a + i, dp->b + i);
+			break;
+		case STREAM_TRIAD:
+			stream_triad(dp->a + i, dp->b + i, dp->c + i);
+			break;
+		}
+
+		i += STREAM_BLOCK_ENTRIES;
+		if (i >= entries)
+			i = 0;
+
+		thread_break(wi->break_reason, wi->thread_number);
+		if (worker_progress(wi, count + 1))
+			break;
+	}
+
+	return rdtsc();
+}
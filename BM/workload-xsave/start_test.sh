@@ -21,8 +21,9 @@ fi
 
 # mode1: test workloads in specific break_reason
 test_single () {
-  echo "trace-cmd record -e x86_fpu -F ./yogini -b $break_reason -r $repeat $option"
-  if ! trace-cmd record -e x86_fpu -F ./yogini -b $break_reason -r $repeat $option; then
+  result_json="${result_dir}/${result}${break_reason}.json"
+  echo "trace-cmd record -e x86_fpu -F ./yogini -b $break_reason -r $repeat -o $result_json $option"
+  if ! trace-cmd record -e x86_fpu -F ./yogini -b $break_reason -r $repeat -o "$result_json" $option; then
     echo "Failed to execute trace-cmd record."
     exit 1
   fi
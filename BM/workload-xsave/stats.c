@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * stats.c - statistics helpers for yogini results
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "yogini.h"
+
+/* lowest value that falls into bucket idx */
+static unsigned long long hist_bucket_low(int idx)
+{
+	int msb;
+
+	if (idx < HIST_SUB_BUCKETS)
+		return idx;
+
+	msb = idx / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+
+	return (unsigned long long)(HIST_SUB_BUCKETS + idx % HIST_SUB_BUCKETS)
+		<< (msb - HIST_SUB_BITS);
+}
+
+void hist_merge(struct histogram *dst, const struct histogram *src)
+{
+	int i;
+
+	if (!src->count)
+		return;
+
+	for (i = 0; i < HIST_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+
+	if (!dst->count || src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	dst->count += src->count;
+	dst->sum += src->sum;
+}
+
+/*
+ * hist_percentile()
+ * return the upper bound of the bucket holding the pct-th percentile,
+ * which over-estimates by at most 1/HIST_SUB_BUCKETS, capped at max
+ */
+unsigned long long hist_percentile(const struct histogram *h, double pct)
+{
+	unsigned long long rank, seen = 0;
+	unsigned long long high;
+	int i;
+
+	if (!h->count)
+		return 0;
+
+	rank = (unsigned long long)(h->count * pct / 100.0);
+	if (rank >= h->count)
+		rank = h->count - 1;
+
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen > rank)
+			break;
+	}
+
+	high = i + 1 < HIST_BUCKETS ? hist_bucket_low(i + 1) - 1 : h->max;
+
+	return high < h->max ? high : h->max;
+}
+
+void hist_print(const char *label, const struct histogram *h)
+{
+	if (!h->count) {
+		printf("%s: no samples\n", label);
+		return;
+	}
+
+	printf("%s: count %llu min %llu avg %llu p50 %llu p99 %llu p99.9 %llu max %llu cycles\n",
+	       label, h->count, h->min, h->sum / h->count,
+	       hist_percentile(h, 50), hist_percentile(h, 99),
+	       hist_percentile(h, 99.9), h->max);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* pct-th percentile of n sorted values, interpolated between neighbours */
+static double sorted_percentile(const double *v, int n, double pct)
+{
+	double pos = (n - 1) * pct / 100.0;
+	int lo = (int)pos;
+
+	if (lo + 1 >= n)
+		return v[n - 1];
+
+	return v[lo] + (v[lo + 1] - v[lo]) * (pos - lo);
+}
+
+/*
+ * trial_summarize()
+ * sort values, reject those outside 1.5 inter-quartile ranges of the
+ * quartiles (Tukey's fences), and summarize the rest
+ */
+void trial_summarize(double *values, int n, struct trial_summary *ts)
+{
+	double q1, q3, low, high, sum = 0, sq = 0;
+	int i, first, last;
+
+	memset(ts, 0, sizeof(*ts));
+	if (n <= 0)
+		return;
+
+	qsort(values, n, sizeof(*values), cmp_double);
+
+	q1 = sorted_percentile(values, n, 25);
+	q3 = sorted_percentile(values, n, 75);
+	low = q1 - 1.5 * (q3 - q1);
+	high = q3 + 1.5 * (q3 - q1);
+
+	for (first = 0; first < n && values[first] < low; first++)
+		;
+	for (last = n - 1; last > first && values[last] > high; last--)
+		;
+
+	ts->count = last - first + 1;
+	ts->outliers = n - ts->count;
+
+	for (i = first; i <= last; i++)
+		sum += values[i];
+	ts->mean = sum / ts->count;
+
+	for (i = first; i <= last; i++)
+		sq += (values[i] - ts->mean) * (values[i] - ts->mean);
+	ts->stddev = ts->count > 1 ? sqrt(sq / (ts->count - 1)) : 0;
+
+	ts->min = values[first];
+	ts->median = sorted_percentile(values + first, ts->count, 50);
+}
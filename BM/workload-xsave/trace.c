@@ -0,0 +1,290 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * trace.c - in-process event trace of the workers
+ *
+ * Every worker appends (tsc, event, cpu) records to its own preallocated
+ * ring, which keeps the last TRACE_ENTRIES records. RDTSCP returns the
+ * CPU in TSC_AUX along with the TSC, so every record also notices
+ * migrations. At exit the rings are written to a binary file, which
+ * --trace_convert turns into Chrome trace JSON for chrome://tracing or
+ * Perfetto.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+#include <x86intrin.h>
+#include "yogini.h"
+
+#define TRACE_ENTRIES	(1 << 16)
+#define TRACE_MAGIC	"YOGTRACE"
+#define TRACE_VERSION	1
+
+struct trace_header {
+	char magic[8];
+	unsigned int version;
+	unsigned int nr_threads;
+	double tsc_per_sec;
+};
+
+struct trace_thread {
+	char name[48];
+	unsigned int thread;
+	unsigned int nr_records;
+};
+
+struct trace_ring {
+	struct trace_record *records;
+	unsigned long long head;
+	int last_cpu;
+	char name[48];
+} __attribute__((aligned(64)));
+
+static const char * const trace_names[] = {
+	[TRACE_INIT_BEGIN] = "init",
+	[TRACE_INIT_END] = "init",
+	[TRACE_RUN_BEGIN] = "run",
+	[TRACE_RUN_END] = "run",
+	[TRACE_BREAK_BEGIN] = "break",
+	[TRACE_BREAK_END] = "break",
+	[TRACE_CLEANUP_BEGIN] = "cleanup",
+	[TRACE_CLEANUP_END] = "cleanup",
+	[TRACE_SIGNAL] = "signal",
+	[TRACE_MIGRATE] = "migrate",
+};
+
+int trace_enabled;
+static struct trace_ring *trace_rings;
+static int trace_nr_rings;
+static __thread struct trace_ring *my_ring;
+
+/*
+ * trace_open()
+ * preallocate the rings of nr_threads workers
+ */
+void trace_open(int nr_threads)
+{
+	int i;
+
+	trace_rings = aligned_alloc(64, sizeof(*trace_rings) * nr_threads);
+	if (!trace_rings)
+		err(1, "trace rings");
+	memset(trace_rings, 0, sizeof(*trace_rings) * nr_threads);
+
+	for (i = 0; i < nr_threads; i++) {
+		trace_rings[i].records = calloc(TRACE_ENTRIES, sizeof(struct trace_record));
+		if (!trace_rings[i].records)
+			err(1, "trace ring");
+		trace_rings[i].last_cpu = -1;
+	}
+	trace_nr_rings = nr_threads;
+	trace_enabled = 1;
+}
+
+/* make the calling worker append to the ring of wi */
+void trace_thread_start(struct work_instance *wi)
+{
+	struct trace_ring *ring = &trace_rings[wi->thread_number];
+
+	snprintf(ring->name, sizeof(ring->name), "Thread %d:%s",
+		 wi->thread_number, wi->workload->name);
+	my_ring = ring;
+}
+
+static void trace_append(struct trace_ring *ring, unsigned long long tsc, int event,
+			 int cpu, unsigned int arg)
+{
+	struct trace_record *r;
+
+	/* atomic, so a signal handler tracing in between gets its own slot */
+	r = &ring->records[__atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED) %
+			   TRACE_ENTRIES];
+	r->tsc = tsc;
+	r->event = event;
+	r->cpu = cpu;
+	r->arg = arg;
+}
+
+/*
+ * trace_event()
+ * append event with arg to the ring of the calling worker,
+ * preceded by a TRACE_MIGRATE record if it moved to another CPU
+ */
+void trace_event(int event, unsigned int arg)
+{
+	struct trace_ring *ring = my_ring;
+	unsigned long long tsc;
+	unsigned int aux;
+	int cpu;
+
+	if (!ring)
+		return;
+
+	tsc = __rdtscp(&aux);
+	cpu = aux & 0xfff;	/* Linux puts the node above bit 12 */
+
+	if (ring->last_cpu >= 0 && cpu != ring->last_cpu)
+		trace_append(ring, tsc, TRACE_MIGRATE, cpu, ring->last_cpu);
+	ring->last_cpu = cpu;
+
+	if (event != TRACE_MIGRATE)
+		trace_append(ring, tsc, event, cpu, arg);
+}
+
+/*
+ * trace_dump()
+ * write the rings, oldest record first, to path and free them
+ */
+void trace_dump(const char *path)
+{
+	struct trace_header hdr = { TRACE_MAGIC, TRACE_VERSION };
+	struct trace_thread th;
+	struct trace_ring *ring;
+	unsigned long long first, i;
+	FILE *fp;
+	int t;
+
+	if (!trace_enabled)
+		return;
+
+	fp = fopen(path, "w");
+	if (!fp)
+		err(1, "%s", path);
+
+	hdr.nr_threads = trace_nr_rings;
+	hdr.tsc_per_sec = tsc_per_sec;
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+		err(1, "%s", path);
+
+	for (t = 0; t < trace_nr_rings; t++) {
+		ring = &trace_rings[t];
+		first = ring->head > TRACE_ENTRIES ? ring->head - TRACE_ENTRIES : 0;
+
+		memset(&th, 0, sizeof(th));
+		memcpy(th.name, ring->name, sizeof(th.name));
+		th.thread = t;
+		th.nr_records = ring->head - first;
+		if (fwrite(&th, sizeof(th), 1, fp) != 1)
+			err(1, "%s", path);
+
+		for (i = first; i < ring->head; i++)
+			if (fwrite(&ring->records[i % TRACE_ENTRIES],
+				   sizeof(struct trace_record), 1, fp) != 1)
+				err(1, "%s", path);
+
+		free(ring->records);
+	}
+
+	if (fclose(fp))
+		err(1, "%s", path);
+
+	free(trace_rings);
+	trace_rings = NULL;
+	trace_enabled = 0;
+}
+
+/* Chrome trace phase of event: B(egin), E(nd) or i(nstant) */
+static char trace_phase(int event)
+{
+	switch (event) {
+	case TRACE_INIT_BEGIN:
+	case TRACE_RUN_BEGIN:
+	case TRACE_BREAK_BEGIN:
+	case TRACE_CLEANUP_BEGIN:
+		return 'B';
+	case TRACE_INIT_END:
+	case TRACE_RUN_END:
+	case TRACE_BREAK_END:
+	case TRACE_CLEANUP_END:
+		return 'E';
+	default:
+		return 'i';
+	}
+}
+
+/*
+ * trace_convert()
+ * convert the binary trace in_path to Chrome trace JSON in out_path,
+ * with timestamps in us from the first record
+ */
+void trace_convert(const char *in_path, const char *out_path)
+{
+	struct trace_header hdr;
+	struct trace_thread th;
+	struct trace_record *records, r;
+	unsigned long long base = ~0ULL;
+	unsigned int t, i;
+	long data;
+	FILE *in, *out;
+	int first = 1;
+
+	in = fopen(in_path, "r");
+	if (!in)
+		err(1, "%s", in_path);
+	if (fread(&hdr, sizeof(hdr), 1, in) != 1 || memcmp(hdr.magic, TRACE_MAGIC, 8) ||
+	    hdr.version != TRACE_VERSION)
+		errx(1, "%s: not a yogini trace", in_path);
+
+	/* the earliest TSC of all threads is time 0 */
+	data = ftell(in);
+	for (t = 0; t < hdr.nr_threads; t++) {
+		if (fread(&th, sizeof(th), 1, in) != 1)
+			errx(1, "%s: truncated", in_path);
+		for (i = 0; i < th.nr_records; i++) {
+			if (fread(&r, sizeof(r), 1, in) != 1)
+				errx(1, "%s: truncated", in_path);
+			if (r.tsc < base)
+				base = r.tsc;
+		}
+	}
+	fseek(in, data, SEEK_SET);
+
+	out = fopen(out_path, "w");
+	if (!out)
+		err(1, "%s", out_path);
+	fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+
+	for (t = 0; t < hdr.nr_threads; t++) {
+		if (fread(&th, sizeof(th), 1, in) != 1)
+			errx(1, "%s: truncated", in_path);
+		th.name[sizeof(th.name) - 1] = '\0';
+
+		fprintf(out, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, "
+			"\"tid\": %u, \"args\": {\"name\": \"%s\"}}", first ? "" : ",",
+			th.thread, th.name);
+		first = 0;
+
+		records = calloc(th.nr_records ? th.nr_records : 1, sizeof(*records));
+		if (!records)
+			err(1, "trace records");
+		if (fread(records, sizeof(*records), th.nr_records, in) != th.nr_records)
+			errx(1, "%s: truncated", in_path);
+
+		for (i = 0; i < th.nr_records; i++) {
+			r = records[i];
+			if (r.event >= sizeof(trace_names) / sizeof(trace_names[0]))
+				continue;
+			fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, "
+				"\"pid\": 0, \"tid\": %u, ", trace_names[r.event], trace_phase(r.event),
+				(r.tsc - base) * 1e6 / hdr.tsc_per_sec, th.thread);
+			if (trace_phase(r.event) == 'i')
+				fprintf(out, "\"s\": \"t\", ");
+			if (r.event == TRACE_MIGRATE)
+				fprintf(out, "\"args\": {\"cpu\": %u, \"from\": %u}}", r.cpu, r.arg);
+			else if (r.event == TRACE_BREAK_BEGIN)
+				fprintf(out, "\"args\": {\"cpu\": %u, \"reason\": \"%s\"}}", r.cpu,
+					break_reason_name(r.arg));
+			else
+				fprintf(out, "\"args\": {\"cpu\": %u}}", r.cpu);
+		}
+		free(records);
+	}
+
+	fprintf(out, "\n]}\n");
+	fclose(in);
+	if (fclose(out))
+		err(1, "%s", out_path);
+}
@@ -21,78 +21,36 @@
 #include <sys/syscall.h>
 #include <unistd.h>
 
-// #pragma GCC target("amx")
+#define KERNEL_TARGET "amx-tile,amx-int8,amx-bf16"
 #define WORKLOAD_NAME "AMX"
-#define XFEATURE_XTILEDATA 18
-#define ARCH_REQ_XCOMP_PERM 0x1023
 #define ROW_NUM 16
 #define COL_NUM 64
 #define BYTES_PER_VECTOR		1024
+#define WORK_ENTRIES(entries)	(entries)
+/* arithmetic operations per entry, tdpbssd: 16x16x64 byte multiply-adds */
+#define OPS_PER_ENTRY		(2 * ROW_NUM * ROW_NUM * COL_NUM)
+/* integer, not floating point, operations */
+#define OPS_INTEGER		1
 #define load_tile_reg(tmm_num, tile, stride)						\
 do {											\
 	asm volatile("tileloadd\t(%0,%1,1), %%tmm" #tmm_num				\
 		     : : "r" ((void *)(tile)->buf), "r" ((long)stride) : "memory")	\
 } while (0)
 
-struct __tile_config {
-	uint8_t palette_id;
-	uint8_t start_row;
-	uint8_t reserved_0[14];
-	uint16_t colsb[8];
-	uint16_t reserved_1[8];
-	uint8_t rows[8];
-	uint8_t reserved_2[8];
-};
-
-union __union_tile_config {
-	struct __tile_config s;
-	uint8_t a[64];
-};
-
 struct thread_data {
 	int8_t *input_x;
 	int8_t *input_y;
 	int32_t *output;
-	int data_entries;
+	size_t data_entries;
 };
 
-static void init_tile_config(union __union_tile_config *dst, uint8_t rows, uint8_t colsb)
-{
-	int32_t i;
-
-	dst->s.palette_id = 1;
-	dst->s.start_row = 0;
-
-	for (i = 0; i < 14; i++)
-		dst->s.reserved_0[i] = 0;
-
-	for (i = 0; i < 8; i++) {
-		dst->s.reserved_1[i] = 0;
-		dst->s.reserved_2[i] = 0;
-	}
-
-	for (i = 0; i < 8; i++) {
-		dst->s.colsb[i] = colsb;
-		dst->s.rows[i] = rows;
-	}
+#include "amx_common.c"
 
-	_tile_loadconfig(dst->a);
-}
-
-/* Set_tiledata_use() - Invoke syscall to set ARCH_SET_STATE_USE */
-static void set_tiledata_use(void)
+static KERNEL void work(void *arg)
 {
-	if (syscall(SYS_arch_prctl, ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA))
-		printf("Fail to do XFEATURE_XTILEDATA\n");
-}
-
-static void work(void *arg)
-{
-	int i;
+	size_t i;
 	struct thread_data *dp = (struct thread_data *)arg;
-	int entries = dp->data_entries;
-
-	set_tiledata_use();
+	size_t entries = WORK_ENTRIES(dp->data_entries);
 
 	for (i = 0; i < entries; ++i) {
 		_tile_loadd(2, dp->input_x + BYTES_PER_VECTOR * i, COL_NUM);
@@ -115,5 +73,8 @@ static struct workload w = {
 
 struct workload *register_AMX(void)
 {
-	return &w;
+	if (cpuid.amx_int8)
+		return &w;
+
+	return NULL;
 }
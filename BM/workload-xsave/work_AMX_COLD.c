@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "AMX_COLD" workload to yogini
+ *
+ * Measure the cold-start cost of AMX: every operation creates a new
+ * thread that requests XTILEDATA permission, and then touches tile data
+ * for the first time, which takes the #NM fault the kernel uses to grow
+ * the thread's xstate buffer, and then touches it again, warm.
+ * The first permission request of the process is the one that grants it,
+ * later ones only check it.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include <pthread.h>
+#include <immintrin.h>
+#include "yogini.h"
+#include <err.h>
+#include <stdint.h>
+
+#define KERNEL_TARGET "amx-tile,amx-int8,amx-bf16"
+#define WORKLOAD_NAME "AMX_COLD"
+#define ROW_NUM 16
+#define COL_NUM 64
+
+#include "amx_common.c"
+
+struct thread_data {
+	struct histogram perm;		/* arch_prctl(ARCH_REQ_XCOMP_PERM) */
+	struct histogram first;		/* first tileloadd, #NM fault */
+	struct histogram warm;		/* second tileloadd */
+	unsigned long long first_perm;	/* permission request that granted it */
+	int8_t tile[ROW_NUM * COL_NUM] __attribute__((aligned(64)));
+};
+
+static KERNEL void *cold_thread(void *arg)
+{
+	struct thread_data *dp = (struct thread_data *)arg;
+	union __union_tile_config cfg;
+	unsigned long long tsc0, tsc1, tsc2, tsc3;
+
+	tsc0 = rdtsc();
+	set_tiledata_use();
+	tsc1 = rdtsc();
+	init_tile_config(&cfg, ROW_NUM, COL_NUM);
+
+	tsc2 = rdtsc();
+	_tile_loadd(0, dp->tile, COL_NUM);
+	tsc3 = rdtsc();
+	hist_add(&dp->first, tsc3 - tsc2);
+
+	tsc2 = rdtsc();
+	_tile_loadd(0, dp->tile, COL_NUM);
+	tsc3 = rdtsc();
+	hist_add(&dp->warm, tsc3 - tsc2);
+
+	if (!dp->perm.count)
+		dp->first_perm = tsc1 - tsc0;
+	hist_add(&dp->perm, tsc1 - tsc0);
+
+	_tile_release();
+
+	return NULL;
+}
+
+static KERNEL void work(void *arg)
+{
+	pthread_t tid;
+
+	if (pthread_create(&tid, NULL, cold_thread, arg))
+		err(1, "%s: pthread_create", WORKLOAD_NAME);
+	pthread_join(tid, NULL);
+}
+
+static int init(struct work_instance *wi)
+{
+	struct thread_data *dp;
+
+	dp = aligned_alloc(64, sizeof(struct thread_data));
+	if (!dp)
+		err(1, "thread_data");
+	memset(dp, 0, sizeof(struct thread_data));
+
+	wi->worker_data = dp;
+
+	return 0;
+}
+
+static int cleanup(struct work_instance *wi)
+{
+	struct thread_data *dp = wi->worker_data;
+	char label[64];
+
+	printf("Thread %d:%s first XTILEDATA permission request %llu cycles\n",
+	       wi->thread_number, WORKLOAD_NAME, dp->first_perm);
+	snprintf(label, sizeof(label), "Thread %d:%s permission", wi->thread_number, WORKLOAD_NAME);
+	hist_print(label, &dp->perm);
+	snprintf(label, sizeof(label), "Thread %d:%s first touch", wi->thread_number, WORKLOAD_NAME);
+	hist_print(label, &dp->first);
+	snprintf(label, sizeof(label), "Thread %d:%s warm touch", wi->thread_number, WORKLOAD_NAME);
+	hist_print(label, &dp->warm);
+
+	free(dp);
+	wi->worker_data = NULL;
+
+	return 0;
+}
+
+#include "run_common.c"
+
+static struct workload w = {
+	"AMX_COLD",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_AMX_COLD(void)
+{
+	if (cpuid.amx_tile)
+		return &w;
+
+	return NULL;
+}
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "AMX_GEMM_INT8" workload to yogini
+ *
+ * Blocked INT8 GEMM with signed x signed dot products into INT32.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include <immintrin.h>
+#include "yogini.h"
+#include <err.h>
+#include <stdint.h>
+
+#define KERNEL_TARGET "amx-tile,amx-int8,amx-bf16"
+#define WORKLOAD_NAME "AMX_GEMM_INT8"
+#define K_PER_TILE	64
+#define OPS_INTEGER	1
+
+typedef int8_t gemm_in_t;
+typedef int32_t gemm_out_t;
+
+static gemm_in_t random_elem(void)
+{
+	return random();
+}
+
+#include "amx_common.c"
+#include "worker_init_amx_gemm.c"
+
+/*
+ * work()
+ * C = A x B, blocked so that a 2x2 block of C accumulators stays resident
+ * in tmm0-3 for the whole K loop, fed by two A tiles (tmm4-5) and two B
+ * tiles (tmm6-7)
+ */
+static KERNEL void work(void *arg)
+{
+	struct thread_data *dp = (struct thread_data *)arg;
+	int m, n, k;
+
+	for (m = 0; m < dp->m; m += BLOCK_MN) {
+		for (n = 0; n < dp->n; n += BLOCK_MN) {
+			_tile_zero(0);
+			_tile_zero(1);
+			_tile_zero(2);
+			_tile_zero(3);
+
+			for (k = 0; k < dp->k; k += K_PER_TILE) {
+				_tile_loadd(4, A_TILE(dp, m, k), dp->k * sizeof(gemm_in_t));
+				_tile_loadd(5, A_TILE(dp, m + TILE_MN, k), dp->k * sizeof(gemm_in_t));
+				_tile_loadd(6, B_TILE(dp, k, n), dp->n * 4);
+				_tile_loadd(7, B_TILE(dp, k, n + TILE_MN), dp->n * 4);
+				_tile_dpbssd(0, 4, 6);
+				_tile_dpbssd(1, 4, 7);
+				_tile_dpbssd(2, 5, 6);
+				_tile_dpbssd(3, 5, 7);
+			}
+
+			_tile_stored(0, C_TILE(dp, m, n), dp->n * sizeof(gemm_out_t));
+			_tile_stored(1, C_TILE(dp, m, n + TILE_MN), dp->n * sizeof(gemm_out_t));
+			_tile_stored(2, C_TILE(dp, m + TILE_MN, n), dp->n * sizeof(gemm_out_t));
+			_tile_stored(3, C_TILE(dp, m + TILE_MN, n + TILE_MN), dp->n * sizeof(gemm_out_t));
+		}
+	}
+}
+
+#include "run_common.c"
+
+static struct workload w = {
+	"AMX_GEMM_INT8",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_AMX_GEMM_INT8(void)
+{
+	if (cpuid.amx_int8)
+		return &w;
+
+	return NULL;
+}
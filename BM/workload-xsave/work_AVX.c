@@ -17,25 +17,29 @@
 #include <immintrin.h>
 #include <err.h>
 
-#pragma GCC target("avx")
+#define KERNEL_TARGET "avx"
 #pragma GCC optimize("unroll-loops")
 #define WORKLOAD_NAME "AVX"
 #define BITS_PER_VECTOR		256
 #define BYTES_PER_VECTOR	(BITS_PER_VECTOR / 8)
 #define WORDS_PER_VECTOR        (BITS_PER_VECTOR / 16)
 #define DWORD_PER_VECTOR	(BITS_PER_VECTOR / 32)
+#define WORK_ENTRIES(entries)	((entries) / sizeof(double))
+/* arithmetic operations per entry, vaddps: 8 single precision adds */
+#define OPS_PER_ENTRY		8
+#define OPS_INTEGER		0
 struct thread_data {
 	float *input_x;
 	float *input_y;
 	float *output;
-	int data_entries;
+	size_t data_entries;
 };
 
-static void work(void *arg)
+static KERNEL void work(void *arg)
 {
-	int i;
+	size_t i;
 	struct thread_data *dp = (struct thread_data *)arg;
-	int entries = dp->data_entries / sizeof(double);
+	size_t entries = WORK_ENTRIES(dp->data_entries);
 
 	for (i = 0; i < entries; ++i) {
 		if (clfulsh) {
@@ -63,5 +67,8 @@ static struct workload w = {
 
 struct workload *register_AVX(void)
 {
-	return &w;
+	if (cpuid.avx)
+		return &w;
+
+	return NULL;
 }
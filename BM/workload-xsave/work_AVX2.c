@@ -17,12 +17,17 @@
 #include <stdint.h>
 #include <err.h>
 
-#pragma GCC target("avx2,fma")
+#define KERNEL_TARGET "avx2,fma"
 #define WORKLOAD_NAME "AVX2"
 #define BITS_PER_VECTOR		256
 #define BYTES_PER_VECTOR	(BITS_PER_VECTOR / 8)
 #define WORDS_PER_VECTOR        (BITS_PER_VECTOR / 16)
 #define DWORD_PER_VECTOR	(BITS_PER_VECTOR / 32)
+#define WORK_ENTRIES(entries)	((entries) / sizeof(double))
+/* arithmetic operations per entry, vpmaddubsw: 32 byte multiplies, 16 word adds */
+#define OPS_PER_ENTRY		48
+/* integer, not floating point, operations */
+#define OPS_INTEGER		1
 
 #pragma GCC optimize("unroll-loops")
 
@@ -30,14 +35,14 @@ struct thread_data {
 	uint8_t *input_x;
 	int8_t *input_y;
 	int16_t *output;
-	int data_entries;
+	size_t data_entries;
 };
 
-static void work(void *arg)
+static KERNEL void work(void *arg)
 {
-	int i;
+	size_t i;
 	struct thread_data *dp = (struct thread_data *)arg;
-	int entries = dp->data_entries / sizeof(double);
+	size_t entries = WORK_ENTRIES(dp->data_entries);
 
 	for (i = 0; i < entries; ++i) {
 		if (clfulsh) {
@@ -65,5 +70,8 @@ static struct workload w = {
 
 struct workload *register_AVX2(void)
 {
-	return &w;
+	if (cpuid.avx2 && cpuid.fma)
+		return &w;
+
+	return NULL;
 }
@@ -20,12 +20,16 @@
 
 #if __GNUC__ >= 11
 
-#pragma GCC target("avx512bf16")
+#define KERNEL_TARGET "avx512bf16"
 #define WORKLOAD_NAME "AVX512"
 #define BITS_PER_VECTOR		512
 #define BYTES_PER_VECTOR	(BITS_PER_VECTOR / 8)
 #define WORDS_PER_VECTOR        (BITS_PER_VECTOR / 16)
 #define DWORD_PER_VECTOR	(BITS_PER_VECTOR / 32)
+#define WORK_ENTRIES(entries)	((entries) / sizeof(double))
+/* arithmetic operations per entry, vdpbf16ps: 32 bf16 multiply-adds */
+#define OPS_PER_ENTRY		64
+#define OPS_INTEGER		0
 
 #pragma GCC optimize("unroll-loops")
 
@@ -35,14 +39,14 @@ struct thread_data {
 	int32_t *input_z;
 	int16_t *input_ones;
 	int32_t *output;
-	int data_entries;
+	size_t data_entries;
 };
 
-static void work(void *arg)
+static KERNEL void work(void *arg)
 {
-	int i;
+	size_t i;
 	struct thread_data *dp = (struct thread_data *)arg;
-	int entries = dp->data_entries / sizeof(double);
+	size_t entries = WORK_ENTRIES(dp->data_entries);
 
 	for (i = 0; i < entries; ++i) {
 		if (clfulsh) {
@@ -76,7 +80,7 @@ static struct workload w = {
 
 struct workload *register_AVX512(void)
 {
-	if (cpuid.avx512f)
+	if (cpuid.avx512_bf16 && cpuid.avx512bw)
 		return &w;
 
 	return NULL;
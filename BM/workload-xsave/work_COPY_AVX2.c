@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "COPY_AVX2" workload to yogini
+ *
+ * Copy with 256-bit AVX loads and stores.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <err.h>
+
+#define KERNEL_TARGET "avx2"
+#define WORKLOAD_NAME "COPY_AVX2"
+
+static KERNEL void copy(void *dest, const void *src, size_t n)
+{
+	__m256i *d = dest;
+	const __m256i *s = src;
+	size_t i;
+
+	for (i = 0; i < n / sizeof(__m256i); i += 4) {
+		__m256i v0 = _mm256_load_si256(s + i);
+		__m256i v1 = _mm256_load_si256(s + i + 1);
+		__m256i v2 = _mm256_load_si256(s + i + 2);
+		__m256i v3 = _mm256_load_si256(s + i + 3);
+
+		_mm256_store_si256(d + i, v0);
+		_mm256_store_si256(d + i + 1, v1);
+		_mm256_store_si256(d + i + 2, v2);
+		_mm256_store_si256(d + i + 3, v3);
+	}
+}
+
+#include "run_copy.c"
+
+static struct workload w = {
+	"COPY_AVX2",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_COPY_AVX2(void)
+{
+	if (cpuid.avx2)
+		return &w;
+
+	return NULL;
+}
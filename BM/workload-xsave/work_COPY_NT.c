@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "COPY_NT" workload to yogini
+ *
+ * Copy with SSE2 non-temporal stores (movntdq), fenced with sfence.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <err.h>
+
+#define WORKLOAD_NAME "COPY_NT"
+
+static void copy(void *dest, const void *src, size_t n)
+{
+	__m128i *d = dest;
+	const __m128i *s = src;
+	size_t i;
+
+	for (i = 0; i < n / sizeof(__m128i); i += 4) {
+		__m128i v0 = _mm_load_si128(s + i);
+		__m128i v1 = _mm_load_si128(s + i + 1);
+		__m128i v2 = _mm_load_si128(s + i + 2);
+		__m128i v3 = _mm_load_si128(s + i + 3);
+
+		_mm_stream_si128(d + i, v0);
+		_mm_stream_si128(d + i + 1, v1);
+		_mm_stream_si128(d + i + 2, v2);
+		_mm_stream_si128(d + i + 3, v3);
+	}
+	_mm_sfence();
+}
+
+#include "run_copy.c"
+
+static struct workload w = {
+	"COPY_NT",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_COPY_NT(void)
+{
+	return &w;
+}
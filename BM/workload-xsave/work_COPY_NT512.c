@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "COPY_NT512" workload to yogini
+ *
+ * Copy with AVX-512 non-temporal stores (vmovntdq), fenced with sfence.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <err.h>
+
+#define KERNEL_TARGET "avx512f"
+#define WORKLOAD_NAME "COPY_NT512"
+
+static KERNEL void copy(void *dest, const void *src, size_t n)
+{
+	__m512i *d = dest;
+	const __m512i *s = src;
+	size_t i;
+
+	for (i = 0; i < n / sizeof(__m512i); i += 4) {
+		__m512i v0 = _mm512_load_si512(s + i);
+		__m512i v1 = _mm512_load_si512(s + i + 1);
+		__m512i v2 = _mm512_load_si512(s + i + 2);
+		__m512i v3 = _mm512_load_si512(s + i + 3);
+
+		_mm512_stream_si512(d + i, v0);
+		_mm512_stream_si512(d + i + 1, v1);
+		_mm512_stream_si512(d + i + 2, v2);
+		_mm512_stream_si512(d + i + 3, v3);
+	}
+	_mm_sfence();
+}
+
+#include "run_copy.c"
+
+static struct workload w = {
+	"COPY_NT512",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_COPY_NT512(void)
+{
+	if (cpuid.avx512f)
+		return &w;
+
+	return NULL;
+}
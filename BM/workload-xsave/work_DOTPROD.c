@@ -13,12 +13,17 @@
 #include <stdint.h>
 #include <err.h>
 
-#pragma GCC target("avx2,fma")
+#define KERNEL_TARGET "avx2,fma"
 
 #define BITS_PER_VECTOR		256
 #define BYTES_PER_VECTOR	(BITS_PER_VECTOR / 8)
 #define WORDS_PER_VECTOR	(BITS_PER_VECTOR / 16)
 #define DWORD_PER_VECTOR	(BITS_PER_VECTOR / 32)
+#define WORK_ENTRIES(entries)	(entries)
+/* arithmetic operations per entry, 32 byte multiply-adds, as VNNI */
+#define OPS_PER_ENTRY		64
+/* integer, not floating point, operations */
+#define OPS_INTEGER		1
 
 #pragma GCC optimize("unroll-loops")
 
@@ -28,14 +33,14 @@ struct thread_data {
 	int32_t *input_z;
 	int16_t *input_ones;
 	int32_t *output;
-	int data_entries;
+	size_t data_entries;
 };
 
-static void work(void *arg)
+static KERNEL void work(void *arg)
 {
-	int i;
+	size_t i;
 	struct thread_data *dp = (struct thread_data *)arg;
-	int entries = dp->data_entries;
+	size_t entries = WORK_ENTRIES(dp->data_entries);
 
 	__m256i v_ones;
 
@@ -74,5 +79,8 @@ static struct workload w = {
 
 struct workload *register_DOTPROD(void)
 {
-	return &w;
+	if (cpuid.avx2 && cpuid.fma)
+		return &w;
+
+	return NULL;
 }
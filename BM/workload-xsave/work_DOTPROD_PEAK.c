@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "DOTPROD_PEAK" workload to yogini
+ *
+ * The AVX2 VPMADDUBSW, VPMADDWD, VPADDD byte dot product of DOTPROD
+ * at port throughput, see run_peak.c
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <err.h>
+
+#define KERNEL_TARGET "avx2,fma"
+#define WORKLOAD_NAME "DOTPROD_PEAK"
+
+#define VEC			__m256i
+#define VEC_ZERO		_mm256_setzero_si256
+#define VEC_ADD			_mm256_add_epi32
+#define VEC_STORE(p, v)		_mm256_store_si256(p, v)
+#define VEC_SET1_8		_mm256_set1_epi8
+#define VEC_SET1_16		_mm256_set1_epi16
+/* one scratch register; as asm, gcc neither hoists the invariant multiplies nor copies acc */
+#define DOT(acc, x, y, ones) do {					\
+	VEC _t;								\
+	asm("vpmaddubsw %3, %2, %1\n\t"				\
+	    "vpmaddwd %4, %1, %1\n\t"					\
+	    "vpaddd %1, %0, %0"						\
+	    : "+x" (acc), "=&x" (_t) : "x" (x), "x" (y), "x" (ones));	\
+} while (0)
+/* 32 byte multiply-adds, as VNNI */
+#define OPS_PER_VEC		64
+/* VPMADDUBSW and VPMADDWD share ports 0 and 1, so one dot product per cycle */
+#define PEAK_VEC_PER_CYCLE	1
+/* 16 YMM, x, y, ones and the scratch */
+#define PEAK_VEC_REGS		16
+#define PEAK_FIXED_REGS		4
+
+#include "run_peak.c"
+
+static struct workload w = {
+	"DOTPROD_PEAK",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_DOTPROD_PEAK(void)
+{
+	if (cpuid.avx2 && cpuid.fma)
+		return &w;
+
+	return NULL;
+}
@@ -24,11 +24,19 @@ static void work(void *arg)
 		asm volatile ("pause");
 }
 
+static int init(struct work_instance *wi)
+{
+	/* report ns per pause instruction */
+	wi->op_elems = DATA_ENTRIES;
+
+	return 0;
+}
+
 #include "run_common.c"
 
 static struct workload w = {
 	"PAUSE",
-	NULL,
+	init,
 	NULL,
 	run,
 };
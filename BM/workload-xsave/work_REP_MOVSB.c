@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "REP_MOVSB" workload to yogini
+ *
+ * Copy with a single rep movsb, fast with ERMS/FSRM.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <stdint.h>
+#include <err.h>
+
+#define WORKLOAD_NAME "REP_MOVSB"
+
+static void copy(void *dest, const void *src, size_t n)
+{
+	asm volatile ("rep movsb"
+		      : "+D" (dest), "+S" (src), "+c" (n)
+		      : : "memory");
+}
+
+#include "run_copy.c"
+
+static struct workload w = {
+	"REP_MOVSB",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_REP_MOVSB(void)
+{
+	return &w;
+}
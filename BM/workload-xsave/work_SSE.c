@@ -14,26 +14,31 @@
 #include <emmintrin.h>
 #include <err.h>
 
-#pragma GCC target("sse4.2")
+#define KERNEL_TARGET "sse4.2"
 #pragma GCC optimize("unroll-loops")
 #define WORKLOAD_NAME "SSE"
 #define BITS_PER_VECTOR		128
 #define BYTES_PER_VECTOR	(BITS_PER_VECTOR / 8)
 #define WORDS_PER_VECTOR        (BITS_PER_VECTOR / 16)
 #define DWORD_PER_VECTOR	(BITS_PER_VECTOR / 32)
+#define WORK_ENTRIES(entries)	((entries) / sizeof(double))
+/* arithmetic operations per entry, paddd: 4 dword adds */
+#define OPS_PER_ENTRY		4
+/* integer, not floating point, operations */
+#define OPS_INTEGER		1
 
 struct thread_data {
 	int32_t *input_x;
 	int32_t *input_y;
 	int32_t *output;
-	int data_entries;
+	size_t data_entries;
 };
 
-static void work(void *arg)
+static KERNEL void work(void *arg)
 {
-	int i;
+	size_t i;
 	struct thread_data *dp = (struct thread_data *)arg;
-	int entries = dp->data_entries / sizeof(double);
+	size_t entries = WORK_ENTRIES(dp->data_entries);
 
 	for (i = 0; i < entries; ++i) {
 		if (clfulsh) {
@@ -62,5 +67,8 @@ static struct workload w = {
 
 struct workload *register_SSE(void)
 {
-	return &w;
+	if (cpuid.sse4_2)
+		return &w;
+
+	return NULL;
 }
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "STREAM_AVX2" workload to yogini
+ *
+ * STREAM kernels with 256-bit AVX vectors, see run_stream.c
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <err.h>
+
+#define KERNEL_TARGET "avx2"
+#define WORKLOAD_NAME "STREAM_AVX2"
+
+#define VEC		__m256d
+#define VEC_LOAD	_mm256_load_pd
+#define VEC_STORE	_mm256_store_pd
+#define VEC_ADD		_mm256_add_pd
+#define VEC_MUL		_mm256_mul_pd
+#define VEC_SET1	_mm256_set1_pd
+#define VEC_ZERO	_mm256_setzero_pd
+
+#include "run_stream.c"
+
+static struct workload w = {
+	"STREAM_AVX2",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_STREAM_AVX2(void)
+{
+	if (cpuid.avx2)
+		return &w;
+
+	return NULL;
+}
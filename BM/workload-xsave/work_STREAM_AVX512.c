@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "STREAM_AVX512" workload to yogini
+ *
+ * STREAM kernels with 512-bit AVX-512 vectors, see run_stream.c
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <err.h>
+
+#define KERNEL_TARGET "avx512f"
+#define WORKLOAD_NAME "STREAM_AVX512"
+
+#define VEC		__m512d
+#define VEC_LOAD	_mm512_load_pd
+#define VEC_STORE	_mm512_store_pd
+#define VEC_ADD		_mm512_add_pd
+#define VEC_MUL		_mm512_mul_pd
+#define VEC_SET1	_mm512_set1_pd
+#define VEC_ZERO	_mm512_setzero_pd
+
+#include "run_stream.c"
+
+static struct workload w = {
+	"STREAM_AVX512",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_STREAM_AVX512(void)
+{
+	if (cpuid.avx512f)
+		return &w;
+
+	return NULL;
+}
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "STREAM_SSE" workload to yogini
+ *
+ * STREAM kernels with 128-bit SSE2 vectors, see run_stream.c
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <err.h>
+
+#define KERNEL_TARGET "sse2"
+#define WORKLOAD_NAME "STREAM_SSE"
+
+#define VEC		__m128d
+#define VEC_LOAD	_mm_load_pd
+#define VEC_STORE	_mm_store_pd
+#define VEC_ADD		_mm_add_pd
+#define VEC_MUL		_mm_mul_pd
+#define VEC_SET1	_mm_set1_pd
+#define VEC_ZERO	_mm_setzero_pd
+
+#include "run_stream.c"
+
+static struct workload w = {
+	"STREAM_SSE",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_STREAM_SSE(void)
+{
+	/* sse2 is part of x86-64, so always available */
+	return &w;
+}
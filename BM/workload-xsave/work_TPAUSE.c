@@ -16,14 +16,14 @@
 
 #if __GNUC__ >= 9
 
-#pragma GCC target("waitpkg")
+#define KERNEL_TARGET "waitpkg"
 
 #define WORKLOAD_NAME "TPAUSE"
 #define TPAUSE_TSC_CYCLES	((unsigned long long)(1000 * 1000))
 
 #define DATA_ENTRIES 1
 
-static void work(void *arg)
+static KERNEL void work(void *arg)
 {
 	unsigned int ctrl;
 	unsigned long long tsc;
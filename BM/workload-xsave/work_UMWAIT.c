@@ -16,13 +16,13 @@
 
 #if __GNUC__ >= 9
 
-#pragma GCC target("waitpkg")
+#define KERNEL_TARGET "waitpkg"
 
 #define WORKLOAD_NAME "UMWAIT"
 
 #define DATA_ENTRIES 1
 
-static void work(void *arg)
+static KERNEL void work(void *arg)
 {
 	char dummy;
 
@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "UMWAIT_LAT" workload to yogini
+ *
+ * Measure the wakeup latency of UMWAIT: the worker arms UMONITOR on a
+ * cache line and waits in C0.1 or C0.2 (--umwait_state), while a waker
+ * thread on another CPU (--umwait_waker) writes its TSC into the line.
+ * One operation is one wakeup, the worker reports the distribution of
+ * TSC cycles from the write to the return from UMWAIT, and how often
+ * UMWAIT returned because the OS time limit of
+ * /sys/devices/system/cpu/umwait_control/max_time expired.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <err.h>
+#include "yogini.h"
+#include <x86intrin.h>
+
+#if __GNUC__ >= 9
+
+#define KERNEL_TARGET "waitpkg"
+
+#define WORKLOAD_NAME "UMWAIT_LAT"
+#define UMWAIT_CONTROL "/sys/devices/system/cpu/umwait_control/"
+
+/* let the worker settle in UMWAIT before the waker writes */
+#define WAKE_DELAY_USEC	20
+
+struct monitor_line {
+	unsigned long long seq;
+	unsigned long long tsc;		/* when the waker wrote seq */
+} __attribute__((aligned(64)));
+
+struct thread_data {
+	struct monitor_line line;
+	int ready __attribute__((aligned(64)));	/* worker is about to wait */
+	int quit;
+	int waker_cpu;
+	unsigned long long timeouts;
+	pthread_t waker;
+	struct histogram latency;
+};
+
+static long saved_max_time = -1;
+/* saved_max_time as written by the signal handler, formatted up front */
+static char saved_max_time_str[32];
+static int saved_max_time_len;
+
+static long umwait_control_read(const char *name)
+{
+	char path[128];
+	long value = -1;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), UMWAIT_CONTROL "%s", name);
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+	if (fscanf(fp, "%ld", &value) != 1)
+		value = -1;
+	fclose(fp);
+
+	return value;
+}
+
+static void umwait_control_write(const char *name, long value)
+{
+	char path[128];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), UMWAIT_CONTROL "%s", name);
+	fp = fopen(path, "w");
+	if (!fp || fprintf(fp, "%ld\n", value) < 0)
+		warn("%s", path);
+	if (fp && fclose(fp))
+		warn("%s", path);
+}
+
+static void restore_max_time(void)
+{
+	umwait_control_write("max_time", saved_max_time);
+}
+
+/*
+ * restore_max_time_signal()
+ * atexit() does not run when a signal kills yogini, so restore max_time
+ * with async-signal-safe calls and die of the signal as before
+ */
+static void restore_max_time_signal(int signum)
+{
+	int fd;
+
+	fd = open(UMWAIT_CONTROL "max_time", O_WRONLY);
+	if (fd >= 0) {
+		if (write(fd, saved_max_time_str, saved_max_time_len) < 0)
+			;	/* nothing to report from a signal handler */
+		close(fd);
+	}
+	raise(signum);
+}
+
+static void restore_max_time_on_signals(void)
+{
+	struct sigaction sigact;
+
+	saved_max_time_len = snprintf(saved_max_time_str, sizeof(saved_max_time_str),
+				      "%ld\n", saved_max_time);
+
+	memset(&sigact, 0, sizeof(sigact));
+	sigact.sa_handler = restore_max_time_signal;
+	/* back to SIG_DFL, so the raise() in the handler terminates */
+	sigact.sa_flags = SA_RESETHAND;
+	sigaction(SIGINT, &sigact, NULL);
+	sigaction(SIGTERM, &sigact, NULL);
+	sigaction(SIGHUP, &sigact, NULL);
+}
+
+/* apply --umwait_max_time, restored at exit or on a fatal signal, and show the OS limits */
+static void umwait_control_setup(void)
+{
+	if (umwait_max_time >= 0) {
+		saved_max_time = umwait_control_read("max_time");
+		if (saved_max_time < 0)
+			warnx("cannot read " UMWAIT_CONTROL "max_time, not setting it");
+		else {
+			umwait_control_write("max_time", umwait_max_time);
+			atexit(restore_max_time);
+			restore_max_time_on_signals();
+		}
+	}
+
+	if (umwait_control_read("max_time") < 0)
+		printf("%s: no " UMWAIT_CONTROL "\n", WORKLOAD_NAME);
+	else
+		printf("%s: umwait_control max_time %ld TSC cycles, enable_c02 %ld\n", WORKLOAD_NAME,
+		       umwait_control_read("max_time"), umwait_control_read("enable_c02"));
+}
+
+static void *waker_main(void *arg)
+{
+	struct thread_data *dp = (struct thread_data *)arg;
+	unsigned long long delay = tsc_per_sec * WAKE_DELAY_USEC / 1e6;
+	unsigned long long start;
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(dp->waker_cpu, &mask);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask))
+		errx(1, "%s: failed to bind waker to CPU %d", WORKLOAD_NAME, dp->waker_cpu);
+
+	for (;;) {
+		while (!__atomic_load_n(&dp->ready, __ATOMIC_ACQUIRE)) {
+			if (__atomic_load_n(&dp->quit, __ATOMIC_RELAXED))
+				return NULL;
+			_mm_pause();
+		}
+		__atomic_store_n(&dp->ready, 0, __ATOMIC_RELAXED);
+
+		start = rdtsc();
+		while (rdtsc() - start < delay)
+			_mm_pause();
+
+		dp->line.tsc = rdtsc();
+		__atomic_store_n(&dp->line.seq, dp->line.seq + 1, __ATOMIC_RELEASE);
+	}
+}
+
+/* one wakeup: wait in UMWAIT until the waker bumps line.seq */
+static KERNEL void work(void *arg)
+{
+	struct thread_data *dp = (struct thread_data *)arg;
+	unsigned long long expected = dp->line.seq + 1;
+	unsigned long long now;
+
+	__atomic_store_n(&dp->ready, 1, __ATOMIC_RELEASE);
+
+	while (__atomic_load_n(&dp->line.seq, __ATOMIC_ACQUIRE) != expected) {
+		_umonitor(&dp->line);
+		if (__atomic_load_n(&dp->line.seq, __ATOMIC_ACQUIRE) == expected)
+			break;
+		/* no deadline of our own, so a timeout is the OS max_time */
+		if (_umwait(umwait_state, (unsigned long long)-1))
+			dp->timeouts++;
+	}
+
+	now = rdtsc();
+	hist_add(&dp->latency, now - dp->line.tsc);
+}
+
+static int init(struct work_instance *wi)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	struct thread_data *dp;
+
+	pthread_once(&once, umwait_control_setup);
+
+	dp = aligned_alloc(64, sizeof(struct thread_data));
+	if (!dp)
+		err(1, "thread_data");
+	memset(dp, 0, sizeof(struct thread_data));
+
+	/* by default wake from the next CPU */
+	dp->waker_cpu = umwait_waker_cpu >= 0 ? umwait_waker_cpu :
+			(sched_getcpu() + 1) % sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (pthread_create(&dp->waker, NULL, waker_main, dp))
+		err(1, "%s: pthread_create", WORKLOAD_NAME);
+
+	wi->worker_data = dp;
+
+	return 0;
+}
+
+static int cleanup(struct work_instance *wi)
+{
+	struct thread_data *dp = wi->worker_data;
+	char label[64];
+
+	__atomic_store_n(&dp->quit, 1, __ATOMIC_RELAXED);
+	pthread_join(dp->waker, NULL);
+
+	snprintf(label, sizeof(label), "Thread %d:%s C0.%d wakeup from CPU %d",
+		 wi->thread_number, WORKLOAD_NAME, umwait_state ? 1 : 2, dp->waker_cpu);
+	hist_print(label, &dp->latency);
+	printf("Thread %d:%s %llu max_time timeouts\n", wi->thread_number, WORKLOAD_NAME,
+	       dp->timeouts);
+
+	free(dp);
+	wi->worker_data = NULL;
+
+	return 0;
+}
+
+#include "run_common.c"
+
+static struct workload w = {
+	"UMWAIT_LAT",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_UMWAIT_LAT(void)
+{
+	if (cpuid.tpause)
+		return &w;
+
+	return NULL;
+}
+#else
+
+#warning GCC < 9 can not build work_UMWAIT_LAT.c
+
+#endif /* GCC < 9 */
@@ -18,12 +18,17 @@
 
 #if __GNUC__ >= 11
 
-#pragma GCC target("avxvnni")
+#define KERNEL_TARGET "avxvnni"
 #define WORKLOAD_NAME "VNNI"
 #define BITS_PER_VECTOR		256
 #define BYTES_PER_VECTOR	(BITS_PER_VECTOR / 8)
 #define WORDS_PER_VECTOR        (BITS_PER_VECTOR / 16)
 #define DWORD_PER_VECTOR	(BITS_PER_VECTOR / 32)
+#define WORK_ENTRIES(entries)	((entries) / sizeof(double))
+/* arithmetic operations per entry, vpdpbusds: 32 byte multiply-adds */
+#define OPS_PER_ENTRY		64
+/* integer, not floating point, operations */
+#define OPS_INTEGER		1
 
 #pragma GCC optimize("unroll-loops")
 
@@ -33,14 +38,14 @@ struct thread_data {
 	int32_t *input_z;
 	int16_t *input_ones;
 	int32_t *output;
-	int data_entries;
+	size_t data_entries;
 };
 
-static void work(void *arg)
+static KERNEL void work(void *arg)
 {
-	int i;
+	size_t i;
 	struct thread_data *dp = (struct thread_data *)arg;
-	int entries = dp->data_entries / sizeof(double);
+	size_t entries = WORK_ENTRIES(dp->data_entries);
 
 	for (i = 0; i < entries; ++i) {
 		if (clfulsh) {
@@ -15,12 +15,17 @@
 
 #if __GNUC__ >= 9
 
-#pragma GCC target("avx512vnni")
+#define KERNEL_TARGET "avx512vnni"
 #define WORKLOAD_NAME "VNNI512"
 #define BITS_PER_VECTOR		512
 #define BYTES_PER_VECTOR	(BITS_PER_VECTOR / 8)
 #define WORDS_PER_VECTOR        (BITS_PER_VECTOR / 16)
 #define DWORD_PER_VECTOR	(BITS_PER_VECTOR / 32)
+#define WORK_ENTRIES(entries)	(entries)
+/* arithmetic operations per entry, vpdpbusds: 64 byte multiply-adds */
+#define OPS_PER_ENTRY		128
+/* integer, not floating point, operations */
+#define OPS_INTEGER		1
 
 #pragma GCC optimize("unroll-loops")
 
@@ -30,14 +35,14 @@ struct thread_data {
 	int32_t *input_z;
 	int16_t *input_ones;
 	int32_t *output;
-	int data_entries;
+	size_t data_entries;
 };
 
-static void work(void *arg)
+static KERNEL void work(void *arg)
 {
-	int i;
+	size_t i;
 	struct thread_data *dp = (struct thread_data *)arg;
-	int entries = dp->data_entries;
+	size_t entries = WORK_ENTRIES(dp->data_entries);
 
 	for (i = 0; i < entries; ++i) {
 		if (clfulsh) {
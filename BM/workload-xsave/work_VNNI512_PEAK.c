@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "VNNI512_PEAK" workload to yogini
+ *
+ * 512-bit VPDPBUSDS at port throughput, see run_peak.c
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <err.h>
+
+#if __GNUC__ >= 9
+
+#define KERNEL_TARGET "avx512vnni"
+#define WORKLOAD_NAME "VNNI512_PEAK"
+
+#define VEC			__m512i
+#define VEC_ZERO		_mm512_setzero_si512
+#define VEC_ADD			_mm512_add_epi32
+#define VEC_STORE(p, v)		_mm512_store_si512(p, v)
+#define VEC_SET1_8		_mm512_set1_epi8
+#define VEC_SET1_16		_mm512_set1_epi16
+/* asm ties acc to one register, the builtin makes gcc copy it around */
+#define DOT(acc, x, y, ones)	\
+	asm("vpdpbusds %2, %1, %0" : "+v" (acc) : "v" (x), "v" (y))
+/* 64 byte multiply-adds */
+#define OPS_PER_VEC		128
+/* two ZMM VPDPBUSDS per cycle on ports 0 and 5 with two 512-bit FMA units */
+#define PEAK_VEC_PER_CYCLE	2
+/* 32 ZMM, x and y */
+#define PEAK_VEC_REGS		32
+#define PEAK_FIXED_REGS		2
+
+#include "run_peak.c"
+
+static struct workload w = {
+	"VNNI512_PEAK",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_VNNI512_PEAK(void)
+{
+	if (cpuid.vnni512)
+		return &w;
+
+	return NULL;
+}
+#else
+
+#warning GCC < 9 can not build work_VNNI512_PEAK.c
+
+#endif /* GCC < 9 */
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * offer the "VNNI_PEAK" workload to yogini
+ *
+ * 256-bit AVX-VNNI VPDPBUSDS at port throughput, see run_peak.c
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>		/* printf(3) */
+#include <stdlib.h>		/* random(3) */
+#include <sched.h>		/* CPU_SET */
+#include "yogini.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <err.h>
+
+#if __GNUC__ >= 11
+
+#define KERNEL_TARGET "avxvnni"
+#define WORKLOAD_NAME "VNNI_PEAK"
+
+#define VEC			__m256i
+#define VEC_ZERO		_mm256_setzero_si256
+#define VEC_ADD			_mm256_add_epi32
+#define VEC_STORE(p, v)		_mm256_store_si256(p, v)
+#define VEC_SET1_8		_mm256_set1_epi8
+#define VEC_SET1_16		_mm256_set1_epi16
+/* asm ties acc to one register, the builtin makes gcc copy it around */
+#define DOT(acc, x, y, ones)	\
+	asm("%{vex%} vpdpbusds %2, %1, %0" : "+x" (acc) : "x" (x), "x" (y))
+/* 32 byte multiply-adds */
+#define OPS_PER_VEC		64
+/* two YMM VPDPBUSDS per cycle on ports 0 and 1 */
+#define PEAK_VEC_PER_CYCLE	2
+/* 16 YMM, x and y */
+#define PEAK_VEC_REGS		16
+#define PEAK_FIXED_REGS		2
+
+#include "run_peak.c"
+
+static struct workload w = {
+	"VNNI_PEAK",
+	init,
+	cleanup,
+	run,
+};
+
+struct workload *register_VNNI_PEAK(void)
+{
+	if (cpuid.avx2vnni)
+		return &w;
+
+	return NULL;
+}
+#else
+
+#warning GCC < 11 can not build work_VNNI_PEAK.c
+
+#endif /* GCC < 11 */
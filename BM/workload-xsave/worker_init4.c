@@ -22,10 +22,10 @@ static double get_random_double(void)
 
 static int init(struct work_instance *wi)
 {
-	int i;
+	size_t i;
 	struct thread_data *dp;
 	int bytes_per_entry = sizeof(double) * 4;	/* a[], x[], y[], z[] */
-	int entries;
+	size_t entries;
 
 	entries = wi->wi_bytes / bytes_per_entry;
 
@@ -11,9 +11,10 @@
 #define YOGINI_MAIN
 #include "yogini.h"
 
-static void init_dword_tile(int8_t *ptr, uint8_t rows, uint8_t colsb, int entries)
+static void init_dword_tile(int8_t *ptr, uint8_t rows, uint8_t colsb, size_t entries)
 {
-	int32_t i, j, k;
+	int32_t i, j;
+	size_t k;
 	int32_t cols = colsb / 4;
 
 	for (k = 0; k < entries; ++k) {
@@ -28,12 +29,14 @@ static int init(struct work_instance *wi)
 	struct thread_data *dp;
 	/* int8_t x[], y[], int32_t output[] */
 	int bytes_per_entry = BYTES_PER_VECTOR * 3;
-	int entries;
+	size_t entries;
 
 	entries = wi->wi_bytes / bytes_per_entry;
 
 	union __union_tile_config cfg;
 
+	/* request XTILEDATA and load the tile config once, not per work() */
+	set_tiledata_use();
 	init_tile_config(&cfg, ROW_NUM, COL_NUM);
 
 	dp = (struct thread_data *)calloc(1, sizeof(struct thread_data));
@@ -57,6 +60,10 @@ static int init(struct work_instance *wi)
 		err(1, "calloc output");
 
 	dp->data_entries = entries;
+	wi->op_bytes = (unsigned long long)WORK_ENTRIES(entries) * bytes_per_entry;
+	wi->op_flops = (unsigned long long)WORK_ENTRIES(entries) * OPS_PER_ENTRY;
+	wi->op_elems = WORK_ENTRIES(entries);
+	wi->op_integer = OPS_INTEGER;
 
 	wi->worker_data = dp;
 
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * AMX GEMM worker code for re-use via inclusion
+ *
+ * The including file defines gemm_in_t, gemm_out_t, K_PER_TILE,
+ * OPS_INTEGER and random_elem(). A is M x K row-major, B is K x N packed in the VNNI
+ * layout AMX expects (4 bytes of consecutive K per column), and C is
+ * M x N row-major.
+ *
+ * Copyright (c) 2024 Intel Corporation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <err.h>
+#include "yogini.h"
+
+#define ROW_NUM		16
+#define COL_NUM		64
+/* consecutive K elements packed into 4 bytes of B */
+#define VNNI_PACK	(4 / sizeof(gemm_in_t))
+/* C rows and columns each accumulator tile covers, 2x2 of them are resident */
+#define TILE_MN		16
+#define BLOCK_MN	(2 * TILE_MN)
+
+struct thread_data {
+	gemm_in_t *a;
+	gemm_in_t *b;
+	gemm_out_t *c;
+	int m;
+	int n;
+	int k;
+};
+
+#define A_TILE(dp, row, col)	((char *)(dp)->a + ((size_t)(row) * (dp)->k + (col)) * sizeof(gemm_in_t))
+#define B_TILE(dp, row, col)	((char *)(dp)->b + ((size_t)(row) / VNNI_PACK * (dp)->n + (col)) * 4)
+#define C_TILE(dp, row, col)	((char *)(dp)->c + ((size_t)(row) * (dp)->n + (col)) * sizeof(gemm_out_t))
+
+static void *alloc_matrix(size_t elems, size_t elem_bytes)
+{
+	void *p;
+
+	if (posix_memalign(&p, 64, elems * elem_bytes))
+		errx(1, "%s: failed to allocate %zu bytes", WORKLOAD_NAME, elems * elem_bytes);
+
+	return p;
+}
+
+static int init(struct work_instance *wi)
+{
+	struct thread_data *dp;
+	union __union_tile_config cfg;
+	size_t i;
+
+	if (gemm_m % BLOCK_MN || gemm_n % BLOCK_MN || gemm_k % K_PER_TILE)
+		errx(1, "%s: M and N must be multiples of %d, K a multiple of %d",
+		     WORKLOAD_NAME, BLOCK_MN, K_PER_TILE);
+
+	set_tiledata_use();
+	init_tile_config(&cfg, ROW_NUM, COL_NUM);
+
+	dp = (struct thread_data *)calloc(1, sizeof(struct thread_data));
+	if (!dp)
+		err(1, "thread_data");
+
+	dp->m = gemm_m;
+	dp->n = gemm_n;
+	dp->k = gemm_k;
+	dp->a = alloc_matrix((size_t)dp->m * dp->k, sizeof(gemm_in_t));
+	dp->b = alloc_matrix((size_t)dp->k * dp->n, sizeof(gemm_in_t));
+	dp->c = alloc_matrix((size_t)dp->m * dp->n, sizeof(gemm_out_t));
+
+	for (i = 0; i < (size_t)dp->m * dp->k; i++)
+		dp->a[i] = random_elem();
+	for (i = 0; i < (size_t)dp->k * dp->n; i++)
+		dp->b[i] = random_elem();
+
+	wi->worker_data = dp;
+	wi->op_bytes = ((size_t)dp->m * dp->k + (size_t)dp->k * dp->n) * sizeof(gemm_in_t) +
+		       (size_t)dp->m * dp->n * sizeof(gemm_out_t);
+	/* one multiply and one add per element of each M x N x K product */
+	wi->op_flops = 2ULL * dp->m * dp->n * dp->k;
+	wi->op_integer = OPS_INTEGER;
+	/* one tile dot product per TILE_MN x TILE_MN x K_PER_TILE */
+	wi->op_elems = (unsigned long long)(dp->m / TILE_MN) * (dp->n / TILE_MN) * (dp->k / K_PER_TILE);
+
+	return 0;
+}
+
+static int cleanup(struct work_instance *wi)
+{
+	struct thread_data *dp = wi->worker_data;
+
+	free(dp->a);
+	free(dp->b);
+	free(dp->c);
+	free(dp);
+	wi->worker_data = NULL;
+
+	return 0;
+}
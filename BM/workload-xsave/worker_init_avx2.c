@@ -8,10 +8,10 @@
 #include <stdint.h>
 static int init(struct work_instance *wi)
 {
-	int i;
+	size_t i;
 	struct thread_data *dp;
 	int bytes_per_entry = BYTES_PER_VECTOR * 3;	/* x[], y[], output[] */
-	int entries;
+	size_t entries;
 
 	entries = wi->wi_bytes / bytes_per_entry;
 
@@ -32,7 +32,7 @@ static int init(struct work_instance *wi)
 		int j;
 
 		for (j = 0; j < BYTES_PER_VECTOR; j++) {
-			int index = i * BYTES_PER_VECTOR + j;
+			size_t index = i * BYTES_PER_VECTOR + j;
 
 			dp->input_x[index] = j;
 			dp->input_y[index] = BYTES_PER_VECTOR + j;
@@ -43,6 +43,10 @@ static int init(struct work_instance *wi)
 	if (dp->output == NULL)
 		err(1, "calloc output");
 	dp->data_entries = entries;
+	wi->op_bytes = (unsigned long long)WORK_ENTRIES(entries) * bytes_per_entry;
+	wi->op_flops = (unsigned long long)WORK_ENTRIES(entries) * OPS_PER_ENTRY;
+	wi->op_elems = WORK_ENTRIES(entries);
+	wi->op_integer = OPS_INTEGER;
 
 	wi->worker_data = dp;
 
@@ -18,8 +18,17 @@
 #include <cpuid.h>
 #include <math.h>
 #include <pthread.h>
+#include <sched.h>
 #include <sys/syscall.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <limits.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id	_sigev_un._tid
+#endif
 #include <linux/futex.h>
+#include <linux/mempolicy.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -36,27 +45,107 @@ enum {
 	BREAK_BY_FUTEX,
 	BREAK_REASON_MAX = BREAK_BY_FUTEX
 } BREAK_REASON;
-#define FUTEX_VAL 0x5E5E5E5E
+
+static const char * const break_names[] = {
+	[BREAK_BY_NOTHING] = "nothing",
+	[BREAK_BY_YIELD] = "yield",
+	[BREAK_BY_SLEEP] = "sleep",
+	[BREAK_BY_TRAP] = "trap",
+	[BREAK_BY_SIGNAL] = "signal",
+	[BREAK_BY_FUTEX] = "futex",
+};
 
 int repeat_cnt;
 int clfulsh;
+int stop_workers;
+static int run_seconds;
+static int warmup_count;
+int trial_count = 1;
+static int sample_msec;
+static char *result_path;
+static char *result_format;
+static int break_latency;
+static struct histogram *break_hist;
+static int sweep;
+static char *scenario_path;
+static char *trace_path;
 char *progname;
 struct workload *all_workloads;
 struct work_instance *first_worker;
 struct work_instance *last_worker;
 
 static int num_worker_threads;
-static int num_checked_in_threads;
-static pthread_mutex_t checkin_mutex;
-static pthread_cond_t checkin_cv = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Sense-reversing spin barrier. The arrival count, the sense waiters spin
+ * on and the common start TSC each sit on their own cache line, so that
+ * late arrivals do not steal the line the waiters are polling.
+ */
+static struct {
+	int count __attribute__((aligned(64)));
+	int sense __attribute__((aligned(64)));
+	unsigned long long start_tsc __attribute__((aligned(64)));
+} checkin;
+
+/* time from the last check-in until all workers start together */
+#define START_DELAY_USEC	500
+/* PAUSEs between sched_yield() while waiting, in case CPUs are oversubscribed */
+#define BARRIER_SPINS		1024
 int32_t break_reason = BREAK_BY_NOTHING;
-static int32_t *futex_ptr;
-static bool *thread_done;
 pthread_t *tid_ptr;
 
+/*
+ * signal and futex breaks are paced at break_hz: every worker arms a
+ * timer that signals itself, and one driver thread bumps break_futex and
+ * wakes all its waiters at once
+ */
+#define BREAK_HZ		1000
+static long break_hz = BREAK_HZ;
+static int32_t break_futex;
+static int workers_done;
+
 unsigned int SIZE_1GB = 1024 * 1024 * 1024;
+int gemm_m = 256, gemm_n = 256, gemm_k = 256;
+int stream_kernel = STREAM_TRIAD;
+int accumulators = 8;
+int umwait_state;
+int umwait_waker_cpu = -1;
+long umwait_max_time = -1;
+
+static const char * const stream_names[] = {
+	[STREAM_READ] = "read",
+	[STREAM_WRITE] = "write",
+	[STREAM_COPY] = "copy",
+	[STREAM_SCALE] = "scale",
+	[STREAM_ADD] = "add",
+	[STREAM_TRIAD] = "triad",
+};
+
+static cpu_set_t worker_cpus;
+static cpu_set_t worker_nodes;
+/* CPU of the main thread, and of the sampler and break driver it starts */
+static int main_cpu;
 
 struct cpuid cpuid;
+double tsc_per_sec;
+static unsigned long long start_delay_tsc;
+
+/*
+ * One line of a --scenario file: workloads that share a core, each on
+ * its own SMT sibling, or all on the same CPU, time sliced
+ */
+#define SCENARIO_WORKLOADS	8
+#define SCENARIO_SECONDS	5
+
+struct scenario {
+	int smt;
+	int count;
+	struct workload *workloads[SCENARIO_WORKLOADS];
+	struct scenario *next;
+};
+
+static struct scenario *first_scenario;
+static int scenario_max_workers;
 
 static void dump_command(int argc, char **argv)
 {
@@ -84,16 +173,48 @@ static void help(void)
 		"usage: %s [OPTIONS]\n"
 		"\n"
 		"%s runs some simple micro workloads\n"
-		"  -w, --workload [workload_name,threads#,break#, ...]\n", progname, progname);
+		"  -w, --workload [workload_name[:threads#[:bytes]]]\n", progname, progname);
 	fprintf(stderr, "Available workloads: ");
 	dump_workloads();
 	fprintf(stderr,
 		"  -r, --repeat, each instance needs to be run\n"
 		"  -b, --break_reason, [yield/sleep/trap/signal/futex]\n"
+		"  -H, --break_hz [Hz], rate of signal and futex breaks, default 1000\n"
+		"  -c, --cpus [cpu_list], pin workers round-robin to the CPUs, eg. 0-3,8\n"
+		"  -n, --numa [node_list], bind workers round-robin to the NUMA nodes\n"
+		"  -s, --seconds [N], stop all workers after N seconds\n"
+		"  -i, --interval [msec], print per-thread throughput every msec\n"
+		"  -o, --output [file], write per-worker results to file\n"
+		"  -F, --format [json/csv], format of --output, default json\n"
+		"  -L, --break_latency, report latency histograms of each break\n"
+		"  -a, --alloc [malloc/4k/thp/2m/1g], page size of MEM/memcpy buffers\n"
+		"  -P, --populate, fault in MEM/memcpy buffers at allocation\n"
+		"  -S, --sweep, repeat the run with L1/L2/L3/DRAM sized working sets\n"
+		"  -g, --gemm [M:N:K], matrix sizes of AMX_GEMM_*, default 256:256:256\n"
+		"  -K, --stream_kernel [read/write/copy/scale/add/triad], default triad\n"
+		"  -A, --accumulators [4-12], chains of the *_PEAK workloads, default 8\n"
+		"  -U, --umwait_state [c0.1/c0.2], state of UMWAIT_LAT, default c0.2\n"
+		"  -V, --umwait_waker [cpu], CPU that wakes UMWAIT_LAT, default the next\n"
+		"  -M, --umwait_max_time [cycles], set umwait_control/max_time during the run\n"
+		"  -t, --trace [file], write a binary trace of worker events to file\n"
+		"  -X, --trace_convert [in:out], convert a --trace file to Chrome JSON\n"
+		"  -C, --scenario [file], co-schedule workloads on one core, see README\n"
+		"  -W, --warmup [N], discard N passes of each worker before --trials\n"
+		"  -T, --trials [M], measure M passes of each worker, report ns/elem stats\n"
+		"  -p, --perf, count cycles, instructions and cache misses per worker\n"
+		"  -R, --perf_raw [code,...], add up to 4 raw perf events to --perf\n"
 		"For more help, see README\n");
 	exit(0);
 }
 
+const char *break_reason_name(int reason)
+{
+	if (reason < 0 || reason > BREAK_REASON_MAX)
+		return "unknown";
+
+	return break_names[reason];
+}
+
 int parse_break_cmd(char *input_string)
 {
 	if (strcmp(input_string, "sleep") == 0)
@@ -111,13 +232,145 @@ int parse_break_cmd(char *input_string)
 	return 0;
 }
 
-static void set_tsc_per_sec(void)
+/*
+ * parse_cpu_list()
+ * parse a kernel style list such as "0-3,8,10-11" into set
+ * return 0 on success, -1 on malformed input
+ */
+static int parse_cpu_list(const char *str, cpu_set_t *set)
 {
-	unsigned int ebx = 0, ecx = 0, edx = 0;
+	char *end;
+	long first, last;
+
+	CPU_ZERO(set);
+
+	while (*str && *str != '\n') {
+		first = strtol(str, &end, 10);
+		if (end == str || first < 0)
+			return -1;
+
+		last = first;
+		if (*end == '-') {
+			str = end + 1;
+			last = strtol(str, &end, 10);
+			if (end == str || last < first)
+				return -1;
+		}
+		if (last >= CPU_SETSIZE)
+			return -1;
+
+		for (; first <= last; first++)
+			CPU_SET(first, set);
+
+		if (*end == ',')
+			end++;
+		else if (*end && *end != '\n')
+			return -1;
+		str = end;
+	}
+
+	return CPU_COUNT(set) ? 0 : -1;
+}
+
+static void get_node_cpus(int node, cpu_set_t *set)
+{
+	char path[64];
+	char buf[4096];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+	fp = fopen(path, "r");
+	if (!fp)
+		err(1, "%s", path);
+
+	if (!fgets(buf, sizeof(buf), fp) || parse_cpu_list(buf, set))
+		errx(1, "NUMA node %d has no CPUs", node);
+
+	fclose(fp);
+}
+
+/* return the n-th set member of set, wrapping around */
+static int nth_in_set(cpu_set_t *set, int n)
+{
+	int i;
+
+	n %= CPU_COUNT(set);
+	for (i = 0; i < CPU_SETSIZE; i++) {
+		if (!CPU_ISSET(i, set))
+			continue;
+		if (n-- == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+static double timespec_diff(struct timespec *end, struct timespec *start)
+{
+	return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * calibrate_tsc()
+ * return TSC cycles per second measured against CLOCK_MONOTONIC_RAW
+ */
+static double calibrate_tsc(void)
+{
+	struct timespec bgn_ts, end_ts, delay = { 0, 100 * 1000 * 1000 };
+	unsigned long long bgntsc, endtsc;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &bgn_ts);
+	bgntsc = rdtsc();
+	nanosleep(&delay, NULL);
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+	endtsc = rdtsc();
+
+	return (endtsc - bgntsc) / timespec_diff(&end_ts, &bgn_ts);
+}
+
+/* XCR0 state components the OS must enable before the CPU features are usable */
+#define XSTATE_SSE		(1 << 1)
+#define XSTATE_YMM		(1 << 2)
+#define XSTATE_AVX512		(7 << 5)	/* opmask, ZMM_Hi256, Hi16_ZMM */
+#define XSTATE_AMX		(3 << 17)	/* XTILECFG, XTILEDATA */
+
+static unsigned long long xgetbv(unsigned int index)
+{
+	unsigned int eax, edx;
+
+	asm volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (index));
+
+	return eax | (unsigned long long)edx << 32;
+}
+
+/*
+ * probe_cpuid()
+ * set the features in cpuid that both the CPU enumerates and the OS
+ * has enabled in XCR0, so that register routines can pick kernels at run time
+ */
+static void probe_cpuid(void)
+{
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
 	unsigned int max_level;
+	unsigned long long xcr0 = 0;
+	int os_ymm, os_zmm, os_amx;
 
 	__cpuid(0, max_level, ebx, ecx, edx);
 
+	__cpuid(1, eax, ebx, ecx, edx);
+	if (ecx & (1 << 27))	/* OSXSAVE */
+		xcr0 = xgetbv(0);
+	os_ymm = (xcr0 & (XSTATE_SSE | XSTATE_YMM)) == (XSTATE_SSE | XSTATE_YMM);
+	os_zmm = os_ymm && (xcr0 & XSTATE_AVX512) == XSTATE_AVX512;
+	os_amx = (xcr0 & XSTATE_AMX) == XSTATE_AMX;
+
+	if (ecx & (1 << 20))
+		cpuid.sse4_2 = 1;
+	if ((ecx & (1 << 28)) && os_ymm)
+		cpuid.avx = 1;
+	if ((ecx & (1 << 12)) && os_ymm)
+		cpuid.fma = 1;
+
 	/* Structured Extended Feature Flags Enumeration Leaf */
 	if (max_level >= 0x7) {
 		unsigned int eax_subleaves;
@@ -128,25 +381,75 @@ static void set_tsc_per_sec(void)
 
 		__cpuid_count(0x7, 0, eax_subleaves, ebx, ecx, edx);
 
-		if (ebx & (1 << 16))
+		if ((ebx & (1 << 5)) && os_ymm)
+			cpuid.avx2 = 1;
+		if ((ebx & (1 << 16)) && os_zmm)
 			cpuid.avx512f = 1;
+		if ((ebx & (1 << 30)) && os_zmm)
+			cpuid.avx512bw = 1;
 		if (ecx & (1 << 5))
 			cpuid.tpause = 1;
-		if (ecx & (1 << 11))
+		if ((ecx & (1 << 11)) && os_zmm)
 			cpuid.vnni512 = 1;
+		if ((edx & (1 << 22)) && os_amx)
+			cpuid.amx_bf16 = 1;
+		if ((edx & (1 << 24)) && os_amx)
+			cpuid.amx_tile = 1;
+		if ((edx & (1 << 25)) && os_amx)
+			cpuid.amx_int8 = 1;
 
 		if (eax_subleaves > 0) {
-			unsigned int eax = 0;
-
 			eax = ebx = ecx = edx = 0;
 			__cpuid_count(0x7, 1, eax, ebx, ecx, edx);
-			if (eax & (1 << 4))
+			if ((eax & (1 << 4)) && os_ymm)
 				cpuid.avx2vnni = 1;
+			if ((eax & (1 << 5)) && os_zmm)
+				cpuid.avx512_bf16 = 1;
 		}
 	}
+}
 
-	if (max_level < 0x15)
-		errx(1, "sorry CPU too old: cpuid level 0x%x < 0x15", max_level);
+/*
+ * set_tsc_per_sec()
+ * set tsc_per_sec from CPUID, else by calibration
+ */
+static void set_tsc_per_sec(void)
+{
+	unsigned int ebx = 0, ecx = 0, edx = 0;
+	unsigned int max_level;
+	const char *tsc_source;
+
+	__cpuid(0, max_level, ebx, ecx, edx);
+
+	/* TSC = crystal * ebx / eax, the crystal is not always enumerated */
+	if (max_level >= 0x15) {
+		unsigned int eax_denominator = 0, ebx_numerator = 0, ecx_hz = 0;
+
+		__cpuid(0x15, eax_denominator, ebx_numerator, ecx_hz, edx);
+		if (eax_denominator && ebx_numerator && ecx_hz) {
+			tsc_per_sec = (double)ecx_hz * ebx_numerator / eax_denominator;
+			tsc_source = "CPUID 0x15";
+		}
+	}
+
+	/* the TSC runs at the base frequency */
+	if (!tsc_per_sec && max_level >= 0x16) {
+		unsigned int eax_base_mhz = 0;
+
+		__cpuid(0x16, eax_base_mhz, ebx, ecx, edx);
+		if (eax_base_mhz) {
+			tsc_per_sec = eax_base_mhz * 1e6;
+			tsc_source = "CPUID 0x16";
+		}
+	}
+
+	if (!tsc_per_sec) {
+		tsc_per_sec = calibrate_tsc();
+		tsc_source = "calibration";
+	}
+
+	start_delay_tsc = tsc_per_sec * START_DELAY_USEC / 1e6;
+	printf("TSC %.1f MHz from %s\n", tsc_per_sec / 1e6, tsc_source);
 }
 
 void register_all_workloads(void)
@@ -169,9 +472,10 @@ struct work_instance *alloc_new_work_instance(void)
 {
 	struct work_instance *wi;
 
-	wi = calloc(1, sizeof(struct work_instance));
+	wi = aligned_alloc(64, sizeof(struct work_instance));
 	if (!wi)
 		err(1, "work_instance");
+	memset(wi, 0, sizeof(struct work_instance));
 
 	wi->workload = all_workloads;	/* default workload is last probed */
 	return wi;
@@ -188,34 +492,180 @@ void register_new_worker(struct work_instance *wi)
 	wi->next = NULL;
 }
 
-int parse_work_cmd(char *work_cmd)
+/*
+ * parse_bytes()
+ * parse a byte count with an optional K/M/G suffix
+ * return 0 if str is malformed
+ */
+static unsigned long long parse_bytes(const char *str)
+{
+	unsigned long long bytes;
+	char *end;
+
+	bytes = strtoull(str, &end, 10);
+	switch (*end) {
+	case 'G':
+	case 'g':
+		bytes *= 1024;
+		/* fallthrough */
+	case 'M':
+	case 'm':
+		bytes *= 1024;
+		/* fallthrough */
+	case 'K':
+	case 'k':
+		bytes *= 1024;
+		end++;
+		break;
+	}
+
+	return *end && *end != '\n' ? 0 : bytes;
+}
+
+/*
+ * parse_work_cmd()
+ * register the work_instances of "name[:threads[:bytes]]"
+ */
+int parse_work_cmd(char *arg)
 {
 	struct work_instance *wi;
 	struct workload *wp;
+	char *work_cmd, *threads_str, *bytes_str;
+	unsigned long long bytes = 0;
+	int threads = 1;
+
+	/* keep argv intact for dump_command() */
+	work_cmd = strdup(arg);
+	if (!work_cmd)
+		err(1, "strdup");
+
+	threads_str = strchr(work_cmd, ':');
+	if (threads_str) {
+		*threads_str++ = '\0';
+		bytes_str = strchr(threads_str, ':');
+		if (bytes_str) {
+			*bytes_str++ = '\0';
+			bytes = parse_bytes(bytes_str);
+			if (!bytes)
+				errx(1, "Invalid working set size '%s'", bytes_str);
+		}
+		threads = atoi(threads_str);
+		if (threads <= 0)
+			errx(1, "Invalid thread count '%s'", threads_str);
+	}
 
 	wp = find_workload(work_cmd);
-	if (wp) {
-		wi = alloc_new_work_instance();
-		wi->workload = wp;
-	} else {
+	if (!wp) {
 		fprintf(stderr, "Unrecognized work parameter '%s' try -h for help\n", work_cmd);
 		exit(1);
 	}
 
-	/* register this work_instance */
-	register_new_worker(wi);
+	while (threads--) {
+		wi = alloc_new_work_instance();
+		wi->workload = wp;
+		wi->wi_bytes = bytes;
+
+		/* register this work_instance */
+		register_new_worker(wi);
+	}
+
+	free(work_cmd);
 	return 0;
 }
 
+static int parse_stream_kernel(const char *name)
+{
+	int i;
+
+	for (i = 0; i <= STREAM_TRIAD; i++) {
+		if (strcmp(name, stream_names[i]) == 0) {
+			stream_kernel = i;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * parse_scenario()
+ * read lines of "smt|core workload workload..." from path,
+ * '#' starts a comment
+ */
+static void parse_scenario(const char *path)
+{
+	struct scenario *sp, **tail = &first_scenario;
+	char line[256], *tok, *save;
+	struct workload *wp;
+	int line_num = 0;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		err(1, "%s", path);
+
+	while (fgets(line, sizeof(line), fp)) {
+		line_num++;
+		line[strcspn(line, "#\n")] = '\0';
+
+		tok = strtok_r(line, " \t", &save);
+		if (!tok)
+			continue;
+
+		sp = calloc(1, sizeof(*sp));
+		if (!sp)
+			err(1, "scenario");
+
+		if (strcmp(tok, "smt") == 0)
+			sp->smt = 1;
+		else if (strcmp(tok, "core") != 0)
+			errx(1, "%s:%d: expect smt or core, not '%s'", path, line_num, tok);
+
+		while ((tok = strtok_r(NULL, " \t", &save))) {
+			if (sp->count == SCENARIO_WORKLOADS)
+				errx(1, "%s:%d: more than %d workloads", path, line_num,
+				     SCENARIO_WORKLOADS);
+			wp = find_workload(tok);
+			if (!wp)
+				errx(1, "%s:%d: unrecognized workload '%s'", path, line_num, tok);
+			sp->workloads[sp->count++] = wp;
+		}
+		if (sp->count < 2)
+			errx(1, "%s:%d: a scenario needs at least two workloads", path, line_num);
+
+		if (sp->count > scenario_max_workers)
+			scenario_max_workers = sp->count;
+		*tail = sp;
+		tail = &sp->next;
+	}
+
+	fclose(fp);
+
+	if (!first_scenario)
+		errx(1, "%s: no scenario", path);
+}
+
 static void initial_ptr(void)
 {
-	futex_ptr = (int32_t *)malloc(sizeof(int32_t) * num_worker_threads);
-	thread_done = (bool *)malloc(sizeof(bool) * num_worker_threads);
+	/* scenarios run at most scenario_max_workers workers at once */
+	if (scenario_max_workers > num_worker_threads)
+		num_worker_threads = scenario_max_workers;
+
 	tid_ptr = (pthread_t *)malloc(sizeof(pthread_t) * num_worker_threads);
-	if (!futex_ptr || !thread_done || !tid_ptr) {
-		printf("Fail to malloc memory for futex_ptr & tid_ptr\n");
+	if (!tid_ptr) {
+		printf("Fail to malloc memory for tid_ptr\n");
 		exit(1);
 	}
+
+	if (break_latency) {
+		break_hist = aligned_alloc(64, sizeof(*break_hist) * num_worker_threads);
+		if (!break_hist)
+			err(1, "break_hist");
+		memset(break_hist, 0, sizeof(*break_hist) * num_worker_threads);
+	}
+
+	if (trace_path)
+		trace_open(num_worker_threads);
 }
 
 static void initial_wi(void)
@@ -225,8 +675,13 @@ static void initial_wi(void)
 	wi = first_worker;
 	while (wi) {
 		wi->break_reason = break_reason;
-		wi->wi_bytes = SIZE_1GB;
+		if (!wi->wi_bytes)
+			wi->wi_bytes = SIZE_1GB;
 		wi->repeat = repeat_cnt;
+		wi->cpu = CPU_COUNT(&worker_cpus) ?
+			  nth_in_set(&worker_cpus, num_worker_threads) : -1;
+		wi->node = CPU_COUNT(&worker_nodes) ?
+			   nth_in_set(&worker_nodes, num_worker_threads) : -1;
 		wi = wi->next;
 		num_worker_threads++;
 	}
@@ -244,9 +699,19 @@ static void deinitialize(void)
 		wi = cur;
 	}
 
-	free(futex_ptr);
-	free(thread_done);
+	while (first_scenario) {
+		struct scenario *sp = first_scenario->next;
+
+		free(first_scenario);
+		first_scenario = sp;
+	}
+
 	free(tid_ptr);
+	free(break_hist);
+
+	result_close();
+	if (trace_path)
+		trace_dump(trace_path);
 }
 
 static void cmdline(int argc, char **argv)
@@ -258,7 +723,31 @@ static void cmdline(int argc, char **argv)
 		{ "work", required_argument, 0, 'w' },
 		{ "repeat", required_argument, 0, 'r' },
 		{ "break_reason", required_argument, 0, 'b' },
+		{ "break_hz", required_argument, 0, 'H' },
 		{"clflush", no_argument, 0, 'f'},
+		{ "cpus", required_argument, 0, 'c' },
+		{ "numa", required_argument, 0, 'n' },
+		{ "seconds", required_argument, 0, 's' },
+		{ "interval", required_argument, 0, 'i' },
+		{ "output", required_argument, 0, 'o' },
+		{ "format", required_argument, 0, 'F' },
+		{ "break_latency", no_argument, 0, 'L' },
+		{ "alloc", required_argument, 0, 'a' },
+		{ "populate", no_argument, 0, 'P' },
+		{ "sweep", no_argument, 0, 'S' },
+		{ "gemm", required_argument, 0, 'g' },
+		{ "scenario", required_argument, 0, 'C' },
+		{ "trace", required_argument, 0, 't' },
+		{ "trace_convert", required_argument, 0, 'X' },
+		{ "stream_kernel", required_argument, 0, 'K' },
+		{ "accumulators", required_argument, 0, 'A' },
+		{ "umwait_state", required_argument, 0, 'U' },
+		{ "umwait_waker", required_argument, 0, 'V' },
+		{ "umwait_max_time", required_argument, 0, 'M' },
+		{ "warmup", required_argument, 0, 'W' },
+		{ "trials", required_argument, 0, 'T' },
+		{ "perf", no_argument, 0, 'p' },
+		{ "perf_raw", required_argument, 0, 'R' },
 		{ 0, 0, 0, 0 }
 	};
 
@@ -267,7 +756,7 @@ static void cmdline(int argc, char **argv)
 	if (argc == 1)
 		help();
 
-	while ((opt = getopt_long_only(argc, argv, "h:w:r:b:f",
+	while ((opt = getopt_long_only(argc, argv, "h:w:r:b:H:fc:n:s:i:o:F:La:PSg:C:pR:W:T:K:U:V:M:t:X:A:",
 				       long_options, &option_index)) != -1) {
 		switch (opt) {
 		case 'w':
@@ -281,9 +770,117 @@ static void cmdline(int argc, char **argv)
 			if (parse_break_cmd(optarg))
 				help();
 			break;
+		case 'H':
+			break_hz = atol(optarg);
+			if (break_hz <= 0 || break_hz > 1000000000L)
+				errx(1, "Invalid break rate '%s'", optarg);
+			break;
 		case 'f':
 			clfulsh = 1;
 			break;
+		case 'c':
+			if (parse_cpu_list(optarg, &worker_cpus))
+				errx(1, "Invalid CPU list '%s'", optarg);
+			break;
+		case 'n':
+			if (parse_cpu_list(optarg, &worker_nodes))
+				errx(1, "Invalid NUMA node list '%s'", optarg);
+			break;
+		case 's':
+			run_seconds = atoi(optarg);
+			if (run_seconds <= 0)
+				errx(1, "Invalid seconds '%s'", optarg);
+			break;
+		case 'i':
+			sample_msec = atoi(optarg);
+			if (sample_msec <= 0)
+				errx(1, "Invalid interval '%s'", optarg);
+			break;
+		case 'o':
+			result_path = optarg;
+			break;
+		case 'F':
+			result_format = optarg;
+			break;
+		case 'L':
+			break_latency = 1;
+			break;
+		case 'a':
+			if (parse_alloc_policy(optarg))
+				errx(1, "Unknown allocation policy '%s'", optarg);
+			break;
+		case 'P':
+			alloc_populate = 1;
+			break;
+		case 'S':
+			sweep = 1;
+			break;
+		case 'g':
+			if (sscanf(optarg, "%d:%d:%d", &gemm_m, &gemm_n, &gemm_k) != 3 ||
+			    gemm_m <= 0 || gemm_n <= 0 || gemm_k <= 0)
+				errx(1, "Invalid GEMM size '%s', expect M:N:K", optarg);
+			break;
+		case 'C':
+			scenario_path = optarg;
+			break;
+		case 't':
+			trace_path = optarg;
+			break;
+		case 'X': {
+			char *out = strchr(optarg, ':');
+
+			if (!out)
+				errx(1, "Invalid trace conversion '%s', expect in:out", optarg);
+			*out++ = '\0';
+			trace_convert(optarg, out);
+			exit(0);
+		}
+		case 'A':
+			accumulators = atoi(optarg);
+			if (accumulators < ACCUMULATORS_MIN || accumulators > ACCUMULATORS_MAX)
+				errx(1, "Invalid accumulators '%s', expect %d-%d", optarg,
+				     ACCUMULATORS_MIN, ACCUMULATORS_MAX);
+			break;
+		case 'U':
+			if (strcasecmp(optarg, "c0.1") == 0)
+				umwait_state = 1;
+			else if (strcasecmp(optarg, "c0.2") == 0)
+				umwait_state = 0;
+			else
+				errx(1, "Invalid UMWAIT state '%s', expect c0.1 or c0.2", optarg);
+			break;
+		case 'V':
+			umwait_waker_cpu = atoi(optarg);
+			if (umwait_waker_cpu < 0 || umwait_waker_cpu >= CPU_SETSIZE)
+				errx(1, "Invalid waker CPU '%s'", optarg);
+			break;
+		case 'M':
+			umwait_max_time = atol(optarg);
+			if (umwait_max_time <= 0)
+				errx(1, "Invalid max_time '%s'", optarg);
+			break;
+		case 'K':
+			if (parse_stream_kernel(optarg))
+				errx(1, "Unknown STREAM kernel '%s'", optarg);
+			break;
+		case 'W':
+			warmup_count = atoi(optarg);
+			if (warmup_count < 0)
+				errx(1, "Invalid warmup '%s'", optarg);
+			break;
+		case 'T':
+			trial_count = atoi(optarg);
+			if (trial_count <= 0)
+				errx(1, "Invalid trials '%s'", optarg);
+			break;
+		case 'p':
+			perf_enabled = 1;
+			break;
+		case 'R':
+			if (parse_perf_raw(optarg))
+				errx(1, "Invalid raw perf events '%s'", optarg);
+			perf_enabled = 1;
+			break;
 		case '?':
 		case 'h':
 		default:
@@ -291,11 +888,36 @@ static void cmdline(int argc, char **argv)
 		}
 	}
 
+	if (CPU_COUNT(&worker_cpus) && CPU_COUNT(&worker_nodes))
+		errx(1, "--cpus and --numa are mutually exclusive");
+
+	/*
+	 * a pass must end on its own for the next one to start, and restarts
+	 * the ops counter that --interval samples
+	 */
+	if ((warmup_count || trial_count > 1) && (run_seconds || scenario_path || sample_msec))
+		errx(1, "--warmup and --trials exclude --seconds, --interval and --scenario");
+
+	if (scenario_path) {
+		if (first_worker || sweep || CPU_COUNT(&worker_nodes))
+			errx(1, "--scenario excludes --work, --sweep and --numa");
+		parse_scenario(scenario_path);
+		/* co-runners must overlap for the whole run, so always time bound */
+		if (!run_seconds)
+			run_seconds = SCENARIO_SECONDS;
+	}
+
+	if (result_format && !result_path)
+		errx(1, "--format needs --output");
+	if (result_path && result_open(result_path, result_format))
+		errx(1, "Unknown result format '%s'", result_format);
+
 	dump_command(argc, argv);
 }
 
 static void initialize(int argc, char **argv)
 {
+	probe_cpuid();
 	set_tsc_per_sec();
 	register_all_workloads();
 	cmdline(argc, argv);
@@ -341,16 +963,11 @@ static uint64_t do_syscall(uint64_t nr, uint64_t rdi, uint64_t rsi, uint64_t rdx
 
 static void signal_handler(int32_t signum)
 {
-	//int32_t current_cpu = sched_getcpu();
-
-	//if (signum == SIGTRAP)
-		//printf("Break by trap, current_cpu=%d\n", current_cpu);
-
-	//if (signum == SIGUSR1)
-		//printf("Break by signal, current_cpu=%d\n", current_cpu);
+	if (trace_enabled)
+		trace_event(TRACE_SIGNAL, signum);
 }
 
-void thread_break(int32_t reason, uint32_t thread_idx)
+static void do_thread_break(int32_t reason, uint32_t thread_idx)
 {
 	struct timespec req;
 
@@ -380,87 +997,501 @@ void thread_break(int32_t reason, uint32_t thread_idx)
 		break;
 	case BREAK_BY_SIGNAL:
 		/*
-		 * Do nothing, main thread send SIGUSR1 to sub thread periodically
+		 * Do nothing, the worker's timer sends it SIGUSR1 at break_hz
 		 * Schedule out current thread by signal handling
 		 */
 		break;
 	case BREAK_BY_FUTEX:
-		/* Schedule out current thread by waiting futex */
-		do_syscall(SYS_futex, (uint64_t)&futex_ptr[thread_idx],
-			   FUTEX_WAIT, FUTEX_VAL, 0, 0, 0);
+		/*
+		 * Schedule out current thread by waiting futex until the
+		 * break driver bumps it, an earlier bump returns at once
+		 */
+		do_syscall(SYS_futex, (uint64_t)&break_futex, FUTEX_WAIT_PRIVATE,
+			   __atomic_load_n(&break_futex, __ATOMIC_ACQUIRE), 0, 0, 0);
 		break;
 	}
 }
 
-static void worker_barrier(void)
+/*
+ * thread_break()
+ * schedule out the calling worker for reason, with --break_latency
+ * time the break so that its cost lands in the worker's histogram
+ *
+ * BREAK_BY_SIGNAL is asynchronous to the worker and is not timed.
+ */
+void thread_break(int32_t reason, uint32_t thread_idx)
 {
-	int i_am_last = 0;
+	unsigned long long tsc = 0;
+
+	if (reason == BREAK_BY_NOTHING || reason == BREAK_BY_SIGNAL) {
+		/* catch migrations between breaks */
+		if (trace_enabled)
+			trace_event(TRACE_MIGRATE, 0);
+		do_thread_break(reason, thread_idx);
+		return;
+	}
+
+	if (trace_enabled)
+		trace_event(TRACE_BREAK_BEGIN, reason);
+	if (break_latency)
+		tsc = rdtsc();
+
+	do_thread_break(reason, thread_idx);
+
+	if (break_latency)
+		hist_add(&break_hist[thread_idx], rdtsc() - tsc);
+	if (trace_enabled)
+		trace_event(TRACE_BREAK_END, reason);
+}
+
+/*
+ * worker_barrier()
+ * wait for all workers to check in, then spin until the common start TSC
+ * published by the last arrival, so that all workers start together
+ *
+ * return the start TSC
+ */
+static unsigned long long worker_barrier(void)
+{
+	unsigned long long start_tsc;
+	int my_sense, spins = 0;
+
+	/* the sense cannot flip before this worker has checked in */
+	my_sense = !__atomic_load_n(&checkin.sense, __ATOMIC_ACQUIRE);
+
+	if (__atomic_add_fetch(&checkin.count, 1, __ATOMIC_ACQ_REL) == num_worker_threads) {
+		checkin.count = 0;
+		__atomic_store_n(&checkin.start_tsc, rdtsc() + start_delay_tsc, __ATOMIC_RELAXED);
+		__atomic_store_n(&checkin.sense, my_sense, __ATOMIC_RELEASE);
+	} else {
+		while (__atomic_load_n(&checkin.sense, __ATOMIC_ACQUIRE) != my_sense) {
+			_mm_pause();
+			if (++spins % BARRIER_SPINS == 0)
+				sched_yield();
+		}
+	}
+
+	start_tsc = __atomic_load_n(&checkin.start_tsc, __ATOMIC_RELAXED);
+	while (rdtsc() < start_tsc)
+		_mm_pause();
 
-	pthread_mutex_lock(&checkin_mutex);
+	return start_tsc;
+}
 
-	num_checked_in_threads += 1;
-	if (num_checked_in_threads == num_worker_threads)
-		i_am_last = 1;
+/*
+ * bind_worker()
+ * pin the calling worker to its CPU or NUMA node, and prefer memory
+ * from that node so worker_data allocated by initialize() is node-local
+ */
+static void bind_worker(struct work_instance *wi)
+{
+	cpu_set_t mask;
+	unsigned long nodemask;
+	unsigned int cpu, node;
 
-	pthread_mutex_unlock(&checkin_mutex);
+	if (wi->cpu < 0 && wi->node < 0)
+		return;
 
-	if (i_am_last) {
-		pthread_cond_broadcast(&checkin_cv);
+	if (wi->cpu >= 0) {
+		CPU_ZERO(&mask);
+		CPU_SET(wi->cpu, &mask);
 	} else {
-		/* wait for all workers to checkin */
-		pthread_mutex_lock(&checkin_mutex);
-		while (num_checked_in_threads < num_worker_threads)
-			if (pthread_cond_wait(&checkin_cv, &checkin_mutex))
-				err(1, "cond_wait: checkin_cv");
-		pthread_mutex_unlock(&checkin_mutex);
+		get_node_cpus(wi->node, &mask);
 	}
+
+	if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask))
+		errx(1, "Thread %d: failed to set affinity", wi->thread_number);
+
+	if (wi->node < 0) {
+		if (syscall(SYS_getcpu, &cpu, &node, NULL))
+			err(1, "getcpu");
+		wi->node = node;
+	}
+
+	if (wi->node >= sizeof(nodemask) * 8)
+		return;
+
+	/* the kernel reads maxnode - 1 bits of nodemask */
+	nodemask = 1UL << wi->node;
+	if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8 + 1))
+		warn("Thread %d: set_mempolicy node %d", wi->thread_number, wi->node);
+}
+
+/* the unit of ns_per_elem: an element of a work() call, or the call */
+static unsigned long long op_elems(struct work_instance *wi)
+{
+	return wi->op_elems ? wi->op_elems : 1;
+}
+
+static const char *ns_unit(struct work_instance *wi)
+{
+	return wi->op_elems ? "ns/elem" : "ns/op";
+}
+
+/*
+ * report_rates()
+ * convert the TSC cycles of wi to ns per element, and to GB/s for data
+ * movement or GFLOPS/TFLOPS, GOPS/TOPS for integer, arithmetic workloads
+ */
+static void report_rates(struct work_instance *wi)
+{
+	double seconds = wi->cycles / tsc_per_sec;
+
+	if (!wi->ops || !seconds)
+		return;
+
+	wi->ns_per_op = seconds * 1e9 / wi->ops;
+	wi->ns_per_elem = wi->ns_per_op / op_elems(wi);
+	wi->gbytes_per_sec = wi->ops * wi->op_bytes / seconds / 1e9;
+	wi->gops_per_sec = wi->ops * wi->op_flops / seconds / 1e9;
+
+	printf("Thread %d:%s %.2f %s", wi->thread_number, wi->workload->name, wi->ns_per_elem,
+	       ns_unit(wi));
+	if (wi->op_flops && wi->gops_per_sec >= 1000)
+		printf(", %.3f %s", wi->gops_per_sec / 1000, wi->op_integer ? "TOPS" : "TFLOPS");
+	else if (wi->op_flops)
+		printf(", %.2f %s", wi->gops_per_sec, wi->op_integer ? "GOPS" : "GFLOPS");
+	else if (wi->op_bytes)
+		printf(", %.2f GB/s", wi->gbytes_per_sec);
+	printf("\n");
+}
+
+/* the period of break_hz */
+static struct timespec break_period(void)
+{
+	struct timespec ts;
+
+	ts.tv_sec = 1 / break_hz;
+	ts.tv_nsec = break_hz == 1 ? 0 : 1000000000L / break_hz;
+
+	return ts;
+}
+
+/*
+ * arm_signal_timer()
+ * create a timer that sends SIGUSR1 to the calling thread at break_hz
+ */
+static void arm_signal_timer(timer_t *timer)
+{
+	struct itimerspec its;
+	struct sigevent sev;
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev.sigev_signo = SIGUSR1;
+	sev.sigev_notify_thread_id = gettid();
+	if (timer_create(CLOCK_MONOTONIC, &sev, timer))
+		err(1, "timer_create");
+
+	its.it_interval = break_period();
+	its.it_value = its.it_interval;
+	if (timer_settime(*timer, 0, &its, NULL))
+		err(1, "timer_settime");
 }
 
 static void *worker_main(void *arg)
 {
-	// cpu_set_t mask;
-	// CPU_ZERO(&mask);
-	// CPU_SET(1, &mask);
-	// pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
 	struct work_instance *wi = (struct work_instance *)arg;
 
+	bind_worker(wi);
+	if (trace_enabled)
+		trace_thread_start(wi);
+
 	/* initialize data for this worker */
+	trace_event(TRACE_INIT_BEGIN, 0);
 	if (wi->workload->initialize)
 		wi->workload->initialize(wi);
-
-	worker_barrier();
+	trace_event(TRACE_INIT_END, 0);
 
 	printf("%s will repeat %u in reason %d\n",
 	       wi->workload->name, wi->repeat, wi->break_reason);
 
-	unsigned long long bgntsc, endtsc;
+	unsigned long long bgntsc, endtsc = 0, trial_cycles, trial_ops;
+	unsigned long long perf_delta[PERF_EVENTS_MAX];
+	struct timespec bgn_ts, end_ts;
+	struct rusage bgn_ru, end_ru;
+	struct perf_set perf;
+	double *trial_ns, trial_seconds;
+	int pass, trials, i;
+	timer_t timer;
+
+	trial_ns = calloc(trial_count, sizeof(*trial_ns));
+	if (!trial_ns)
+		err(1, "trials");
+
+	wi->perf_active = perf_enabled && perf_open(&perf) == 0;
+
+	/*
+	 * run warmup_count passes that are not measured, then trial_count
+	 * passes that are, all workers start every pass together.
+	 * perf counts and context switches cover only the measured run()s,
+	 * not the barrier waits between them
+	 */
+	trial_cycles = trial_ops = 0;
+	trial_seconds = 0;
+	trials = 0;
+	wi->ctx_switches = 0;
+	memset(wi->perf_count, 0, sizeof(wi->perf_count));
+	for (pass = 0; pass < warmup_count + trial_count; pass++) {
+		bgntsc = worker_barrier();
+		if (pass >= warmup_count) {
+			if (pass == warmup_count && wi->break_reason == BREAK_BY_SIGNAL)
+				arm_signal_timer(&timer);
+			getrusage(RUSAGE_THREAD, &bgn_ru);
+			if (wi->perf_active)
+				perf_begin(&perf);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &bgn_ts);
+		trace_event(TRACE_RUN_BEGIN, pass);
+		endtsc = wi->workload->run(wi);
+		trace_event(TRACE_RUN_END, pass);
+		clock_gettime(CLOCK_MONOTONIC, &end_ts);
+		if (pass < warmup_count)
+			continue;
 
-	bgntsc = rdtsc();
-	endtsc = wi->workload->run(wi);
+		if (wi->perf_active) {
+			perf_end(&perf, perf_delta);
+			for (i = 0; i < perf_nr_events; i++)
+				wi->perf_count[i] += perf_delta[i];
+		}
+		getrusage(RUSAGE_THREAD, &end_ru);
+		wi->ctx_switches += end_ru.ru_nvcsw + end_ru.ru_nivcsw -
+				    bgn_ru.ru_nvcsw - bgn_ru.ru_nivcsw;
+
+		trial_cycles += endtsc - bgntsc;
+		trial_ops += wi->ops;
+		trial_seconds += timespec_diff(&end_ts, &bgn_ts);
+		/* a pass stopped before its first operation has no ns/elem */
+		if (wi->ops)
+			trial_ns[trials++] = (endtsc - bgntsc) * 1e9 / tsc_per_sec /
+					     wi->ops / op_elems(wi);
+	}
+	if (wi->break_reason == BREAK_BY_SIGNAL)
+		timer_delete(timer);
+	wi->cycles = trial_cycles;
+	wi->ops = trial_ops;
+	wi->seconds = trial_seconds;
+	if (syscall(SYS_getcpu, &wi->last_cpu, &wi->last_node, NULL))
+		wi->last_cpu = wi->last_node = -1;
+	trial_summarize(trial_ns, trials, &wi->trials);
+	free(trial_ns);
 	printf("Thread %d:%s took %llu clock-cycles, end in %llu.\n",
-	       wi->thread_number, wi->workload->name, endtsc - bgntsc, endtsc);
+	       wi->thread_number, wi->workload->name, wi->cycles, endtsc);
+	report_rates(wi);
+	if (trial_count > 1)
+		printf("Thread %d:%s %d trials, %d outliers: mean %.2f stddev %.2f "
+		       "min %.2f median %.2f %s\n", wi->thread_number, wi->workload->name,
+		       wi->trials.count, wi->trials.outliers, wi->trials.mean,
+		       wi->trials.stddev, wi->trials.min, wi->trials.median, ns_unit(wi));
+	if (wi->perf_active) {
+		perf_check(&perf, wi);
+		perf_print(wi);
+		perf_close(&perf);
+	}
 
 	/* cleanup data for this worker */
+	trace_event(TRACE_CLEANUP_BEGIN, 0);
 	if (wi->workload->cleanup)
 		wi->workload->cleanup(wi);
+	trace_event(TRACE_CLEANUP_END, 0);
 
-	thread_done[wi->thread_number] = true;
+	__atomic_add_fetch(&workers_done, 1, __ATOMIC_RELEASE);
 	pthread_exit((void *)0);
 	/* thread exit */
 }
 
+/*
+ * sampler_main()
+ * once all workers checked in, snapshot every worker's ops counter each
+ * sample_msec and print the throughput of the interval, and set
+ * stop_workers after run_seconds
+ */
+static void *sampler_main(void *arg)
+{
+	struct work_instance *wi;
+	struct timespec start, next, now;
+	unsigned long long *last_ops;
+	unsigned long long ops;
+	double last_sec = 0, sec;
+	long step_nsec;
+	int i, sample = 0, done;
+
+	last_ops = calloc(num_worker_threads, sizeof(*last_ops));
+	if (!last_ops)
+		err(1, "calloc last_ops");
+
+	while (!__atomic_load_n(&checkin.start_tsc, __ATOMIC_ACQUIRE))
+		usleep(100);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	next = start;
+	/* without sampling, still poll so that an early finish is noticed */
+	step_nsec = (sample_msec ? sample_msec : 100) * 1000000L;
+
+	for (;;) {
+		next.tv_sec += step_nsec / 1000000000L;
+		next.tv_nsec += step_nsec % 1000000000L;
+		if (next.tv_nsec >= 1000000000L) {
+			next.tv_sec++;
+			next.tv_nsec -= 1000000000L;
+		}
+		if (run_seconds && (next.tv_sec > start.tv_sec + run_seconds ||
+				    (next.tv_sec == start.tv_sec + run_seconds &&
+				     next.tv_nsec > start.tv_nsec))) {
+			next.tv_sec = start.tv_sec + run_seconds;
+			next.tv_nsec = start.tv_nsec;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL))
+			;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		sec = timespec_diff(&now, &start);
+
+		for (wi = first_worker, i = 0, done = 0; wi; wi = wi->next, i++) {
+			ops = __atomic_load_n(&wi->ops, __ATOMIC_RELAXED);
+			if (sample_msec)
+				printf("Sample %d %.3f s: Thread %d:%s %llu ops, %.0f ops/s\n",
+				       sample, sec, wi->thread_number, wi->workload->name,
+				       ops - last_ops[i], (ops - last_ops[i]) / (sec - last_sec));
+			last_ops[i] = ops;
+		}
+		done = __atomic_load_n(&workers_done, __ATOMIC_ACQUIRE);
+		last_sec = sec;
+		sample++;
+
+		if (run_seconds && sec >= run_seconds) {
+			__atomic_store_n(&stop_workers, 1, __ATOMIC_RELAXED);
+			break;
+		}
+		if (done == num_worker_threads)
+			break;
+	}
+
+	free(last_ops);
+	return NULL;
+}
+
+/* return true if wi is the first worker running its workload */
+static bool first_of_workload(struct work_instance *wi)
+{
+	struct work_instance *wp;
+
+	for (wp = first_worker; wp != wi; wp = wp->next)
+		if (wp->workload == wi->workload)
+			return false;
+
+	return true;
+}
+
+/* merge the break latency histograms of all workers of each workload */
+static void report_break_latency(void)
+{
+	struct work_instance *wi, *wp;
+	struct histogram *merged;
+	char label[64];
+
+	merged = aligned_alloc(64, sizeof(*merged));
+	if (!merged)
+		err(1, "histogram");
+
+	for (wi = first_worker; wi; wi = wi->next) {
+		if (!first_of_workload(wi))
+			continue;
+
+		memset(merged, 0, sizeof(*merged));
+		for (wp = wi; wp; wp = wp->next)
+			if (wp->workload == wi->workload)
+				hist_merge(merged, &break_hist[wp->thread_number]);
+
+		snprintf(label, sizeof(label), "Break latency %s (%s)",
+			 wi->workload->name, break_reason_name(break_reason));
+		hist_print(label, merged);
+	}
+
+	free(merged);
+}
+
+/*
+ * break_driver_main()
+ * at every tick of break_hz, release all workers waiting in a futex
+ * break with a single FUTEX_WAKE, until every worker is done
+ */
+static void *break_driver_main(void *arg)
+{
+	struct itimerspec its;
+	uint64_t ticks;
+	int fd;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, 0);
+	if (fd < 0)
+		err(1, "timerfd_create");
+
+	its.it_interval = break_period();
+	its.it_value = its.it_interval;
+	if (timerfd_settime(fd, 0, &its, NULL))
+		err(1, "timerfd_settime");
+
+	while (__atomic_load_n(&workers_done, __ATOMIC_ACQUIRE) < num_worker_threads) {
+		if (read(fd, &ticks, sizeof(ticks)) != sizeof(ticks))
+			err(1, "timerfd read");
+		__atomic_add_fetch(&break_futex, 1, __ATOMIC_RELEASE);
+		syscall(SYS_futex, &break_futex, FUTEX_WAKE_PRIVATE, INT_MAX, 0, 0, 0);
+	}
+
+	close(fd);
+	return NULL;
+}
+
+/*
+ * report_node_bandwidth()
+ * sum the GB/s of the data movement workers on each NUMA node they
+ * finished on, arithmetic workloads report GFLOPS or GOPS instead
+ */
+static void report_node_bandwidth(void)
+{
+	struct work_instance *wi;
+	double gbytes_per_sec;
+	int node, max_node = -1, workers;
+
+	for (wi = first_worker; wi; wi = wi->next)
+		if (!wi->op_flops && wi->op_bytes && wi->last_node > max_node)
+			max_node = wi->last_node;
+
+	for (node = 0; node <= max_node; node++) {
+		gbytes_per_sec = 0;
+		workers = 0;
+		for (wi = first_worker; wi; wi = wi->next) {
+			if (wi->op_flops || !wi->op_bytes || wi->last_node != node)
+				continue;
+			gbytes_per_sec += wi->gbytes_per_sec;
+			workers++;
+		}
+		if (workers)
+			printf("Node %d: %.2f GB/s from %d workers\n", node, gbytes_per_sec, workers);
+	}
+}
+
 static void start_and_wait_for_workers(void)
 {
 	int i;
 	cpu_set_t mask;
 	struct work_instance *wi;
 	struct sigaction sigact;
-	bool all_thread_done = false;
+	pthread_t sampler, break_driver;
 
 	CPU_ZERO(&mask);
-	CPU_SET(0, &mask);
+	CPU_SET(main_cpu, &mask);
 	pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
 
+	/* reset state left by a previous run */
+	stop_workers = 0;
+	workers_done = 0;
+	checkin.start_tsc = 0;
+	for (wi = first_worker; wi; wi = wi->next)
+		wi->ops = 0;
+	if (break_latency)
+		memset(break_hist, 0, sizeof(*break_hist) * num_worker_threads);
+
 	if (break_reason == BREAK_BY_TRAP) {
 		sigact.sa_handler = signal_handler;
 		sigemptyset(&sigact.sa_mask);
@@ -477,8 +1508,6 @@ static void start_and_wait_for_workers(void)
 
 	/* create workers */
 	for (wi = first_worker, i = 0; wi; wi = wi->next, i++) {
-		futex_ptr[i] = FUTEX_VAL;
-		thread_done[i] = false;
 		wi->thread_number = i;
 		pthread_attr_t attr;
 
@@ -491,49 +1520,247 @@ static void start_and_wait_for_workers(void)
 		wi->thread_id = tid_ptr[i];
 	}
 
-	sleep(1);
-
-	if (break_reason == BREAK_BY_SIGNAL) {
-		while (!all_thread_done) {
-			all_thread_done = true;
-			for (i = 0; i < num_worker_threads; i++) {
-				if (!thread_done[i]) {
-					pthread_kill(tid_ptr[i], SIGUSR1);
-					all_thread_done = false;
-					/*
-					 * wait 0.5 second to prevent from
-					 * sending signal too frequently
-					 */
-					usleep(1);
-				}
-			}
-		}
+	if (run_seconds || sample_msec) {
+		if (pthread_create(&sampler, NULL, &sampler_main, NULL) != 0)
+			err(1, "pthread_create sampler");
 	}
 
-	/* Wake up the sub-thread waiting on a futex */
 	if (break_reason == BREAK_BY_FUTEX) {
-		while (!all_thread_done) {
-			all_thread_done = true;
-			for (i = 0; i < num_worker_threads; i++) {
-				if (!thread_done[i]) {
-					syscall(SYS_futex, &futex_ptr[i], FUTEX_WAKE, 1, 0, 0, 0);
-					all_thread_done = false;
-					/* wait 0.5 second to prevent from printing too much */
-					usleep(1);
-				}
-			}
-		}
+		if (pthread_create(&break_driver, NULL, &break_driver_main, NULL) != 0)
+			err(1, "pthread_create break driver");
 	}
 
 	/* wait for all workers to join */
 	for (wi = first_worker, i = 0; wi; wi = wi->next, ++i)
 		if (pthread_join(tid_ptr[i], NULL) != 0)
 			err(0, "thread %ld failed to join\n", wi->thread_id);
+
+	if (run_seconds || sample_msec)
+		pthread_join(sampler, NULL);
+	if (break_reason == BREAK_BY_FUTEX)
+		pthread_join(break_driver, NULL);
+
+	for (wi = first_worker; wi; wi = wi->next)
+		result_write(wi);
+
+	report_node_bandwidth();
+
+	if (break_latency)
+		report_break_latency();
+}
+
+/*
+ * cache_bytes()
+ * return the size of the level data or unified cache of CPU 0, 0 if none
+ */
+static unsigned long long cache_bytes(int level)
+{
+	char path[80], type[32], size[32];
+	int index, cache_level;
+	FILE *fp;
+
+	for (index = 0; ; index++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+		fp = fopen(path, "r");
+		if (!fp)
+			return 0;
+		if (fscanf(fp, "%d", &cache_level) != 1)
+			cache_level = -1;
+		fclose(fp);
+		if (cache_level != level)
+			continue;
+
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+		fp = fopen(path, "r");
+		if (!fp || fscanf(fp, "%31s", type) != 1)
+			type[0] = '\0';
+		if (fp)
+			fclose(fp);
+		if (strcmp(type, "Instruction") == 0)
+			continue;
+
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+		fp = fopen(path, "r");
+		if (!fp || fscanf(fp, "%31s", size) != 1)
+			size[0] = '\0';
+		if (fp)
+			fclose(fp);
+
+		return parse_bytes(size);
+	}
+}
+
+/* working sets must be a multiple of this for every workload */
+#define SWEEP_ALIGN	(8 * 1024)
+
+/*
+ * run_sweep()
+ * run all workers with working sets that fit in half of L1, L2 and L3,
+ * and with one of 4x L3 for DRAM, and report the bandwidth of each size
+ */
+static void run_sweep(void)
+{
+	struct {
+		const char *name;
+		unsigned long long bytes;
+	} steps[] = {
+		{ "L1", cache_bytes(1) / 2 },
+		{ "L2", cache_bytes(2) / 2 },
+		{ "L3", cache_bytes(3) / 2 },
+		{ "DRAM", 0 },
+	};
+	struct work_instance *wi, *wp;
+	unsigned long long bytes;
+	double bytes_per_sec;
+	int i;
+
+	/* DRAM is four times the largest cache */
+	for (i = 0; i < 3; i++)
+		if (steps[i].bytes * 8 > steps[3].bytes)
+			steps[3].bytes = steps[i].bytes * 8;
+	if (!steps[3].bytes)
+		steps[3].bytes = SIZE_1GB;
+
+	for (i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+		bytes = steps[i].bytes / SWEEP_ALIGN * SWEEP_ALIGN;
+		if (!bytes)
+			continue;
+
+		for (wi = first_worker; wi; wi = wi->next)
+			wi->wi_bytes = bytes;
+
+		start_and_wait_for_workers();
+
+		for (wi = first_worker; wi; wi = wi->next) {
+			if (!first_of_workload(wi))
+				continue;
+
+			bytes_per_sec = 0;
+			for (wp = wi; wp; wp = wp->next)
+				if (wp->workload == wi->workload && wp->seconds)
+					bytes_per_sec += wp->ops * wp->op_bytes / wp->seconds;
+
+			printf("Sweep %s %llu KB: %s %.2f GB/s\n", steps[i].name,
+			       bytes / 1024, wi->workload->name, bytes_per_sec / 1e9);
+		}
+	}
+}
+
+/*
+ * sibling_cpus()
+ * fill set with the SMT siblings of cpu, just cpu if unknown
+ */
+static void sibling_cpus(int cpu, cpu_set_t *set)
+{
+	char path[80], list[256];
+	FILE *fp;
+
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+	fp = fopen(path, "r");
+	if (!fp || !fgets(list, sizeof(list), fp) || parse_cpu_list(list, set)) {
+		CPU_ZERO(set);
+		CPU_SET(cpu, set);
+	}
+	if (fp)
+		fclose(fp);
+}
+
+static double ops_per_sec(struct work_instance *wi)
+{
+	return wi->seconds ? wi->ops / wi->seconds : 0;
+}
+
+/*
+ * run_scenarios()
+ * for each scenario, run every workload alone on its CPU, then all of
+ * them together, and report the slowdown of each workload.
+ * Time slicing on one CPU alone costs a factor of the workload count,
+ * "excess" is the slowdown beyond that fair share, e.g. due to
+ * saving and restoring larger XSAVE state on every context switch.
+ */
+static void run_scenarios(void)
+{
+	struct work_instance *wis[SCENARIO_WORKLOADS];
+	double alone[SCENARIO_WORKLOADS], shared, slowdown;
+	struct scenario *sp;
+	cpu_set_t siblings, allowed;
+	int base_cpu, cpu, i, n;
+
+	if (sched_getaffinity(0, sizeof(allowed), &allowed))
+		err(1, "sched_getaffinity");
+
+	/* default to the last CPU, away from CPU 0 and its housekeeping */
+	base_cpu = CPU_COUNT(&worker_cpus) ? nth_in_set(&worker_cpus, 0) :
+		   nth_in_set(&allowed, CPU_COUNT(&allowed) - 1);
+	sibling_cpus(base_cpu, &siblings);
+
+	/* keep the main thread and its helpers off the measured core */
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, &allowed) && !CPU_ISSET(cpu, &siblings))
+			break;
+	if (cpu < CPU_SETSIZE)
+		main_cpu = cpu;
+	else
+		warnx("No CPU outside the core of CPU %d, the harness shares it", base_cpu);
+
+	for (sp = first_scenario, n = 0; sp; sp = sp->next, n++) {
+		if (sp->smt && CPU_COUNT(&siblings) < sp->count)
+			errx(1, "Scenario %d: CPU %d has %d SMT siblings, need %d",
+			     n, base_cpu, CPU_COUNT(&siblings), sp->count);
+
+		for (i = 0; i < sp->count; i++) {
+			wis[i] = alloc_new_work_instance();
+			wis[i]->workload = sp->workloads[i];
+			wis[i]->break_reason = break_reason;
+			wis[i]->wi_bytes = SIZE_1GB;
+			wis[i]->cpu = sp->smt ? nth_in_set(&siblings, i) : base_cpu;
+			wis[i]->node = -1;
+		}
+
+		/* each workload alone */
+		for (i = 0; i < sp->count; i++) {
+			first_worker = wis[i];
+			wis[i]->next = NULL;
+			num_worker_threads = 1;
+			start_and_wait_for_workers();
+			alone[i] = ops_per_sec(wis[i]);
+		}
+
+		/* all together */
+		for (i = 0; i < sp->count; i++)
+			wis[i]->next = i + 1 < sp->count ? wis[i + 1] : NULL;
+		first_worker = wis[0];
+		num_worker_threads = sp->count;
+		start_and_wait_for_workers();
+
+		for (i = 0; i < sp->count; i++) {
+			shared = ops_per_sec(wis[i]);
+			slowdown = shared ? alone[i] / shared : 0;
+			printf("Scenario %d %s: %s on CPU %d alone %.0f ops/s, shared %.0f ops/s, "
+			       "slowdown %.2fx, excess %.2fx, %ld context switches\n",
+			       n, sp->smt ? "smt" : "core", wis[i]->workload->name, wis[i]->cpu,
+			       alone[i], shared, slowdown,
+			       sp->smt ? slowdown : slowdown / sp->count, wis[i]->ctx_switches);
+		}
+
+		for (i = 0; i < sp->count; i++)
+			free(wis[i]);
+		first_worker = NULL;
+	}
 }
 
 int main(int argc, char **argv)
 {
 	initialize(argc, argv);
-	start_and_wait_for_workers();
+	if (first_scenario)
+		run_scenarios();
+	else if (sweep)
+		run_sweep();
+	else
+		start_and_wait_for_workers();
 	deinitialize();
 }
@@ -13,9 +13,18 @@
 #include <stdio.h>
 #include <pthread.h>
 
-#ifndef CMAKE_FLAG
-#define CMAKE_FLAG 1
-#endif
+/* generic perf events plus up to 4 --perf_raw events */
+#define PERF_EVENTS_MAX		9
+
+/* statistics of repeated measurements, see trial_summarize() */
+struct trial_summary {
+	int count;		/* trials kept */
+	int outliers;		/* trials rejected */
+	double mean;
+	double stddev;
+	double min;
+	double median;
+};
 
 struct work_instance {
 	struct work_instance *next;
@@ -24,8 +33,33 @@ struct work_instance {
 	struct workload *workload;
 	void *worker_data;
 	unsigned int repeat;
-	unsigned int wi_bytes;
+	unsigned long long wi_bytes;
 	int break_reason;
+	int cpu;		/* CPU to pin to, -1 if not pinned */
+	int node;		/* NUMA node to bind to, -1 if not bound */
+	unsigned long long op_bytes;	/* bytes touched by one operation */
+	unsigned long long op_flops;	/* arithmetic operations in one operation */
+	int op_integer;		/* op_flops are integer, not floating point */
+	/* vector entries, tile products or lines in one operation, 0 for one */
+	unsigned long long op_elems;
+	unsigned long long cycles;	/* TSC cycles spent in run() */
+	double seconds;		/* wall time spent in run() */
+	int last_cpu;		/* CPU the worker finished on */
+	int last_node;		/* and its NUMA node */
+	long ctx_switches;	/* context switches during run() */
+	/* rates over the TSC cycles of run(), see report_rates() */
+	double ns_per_op;
+	double ns_per_elem;	/* ns_per_op over op_elems, or ns_per_op */
+	double gbytes_per_sec;
+	double gops_per_sec;
+	/* ns/elem over the --trials passes of run() */
+	struct trial_summary trials;
+	/* the worker opened its perf group, --perf may still fail per worker */
+	int perf_active;
+	/* perf counter deltas over run(), see perf.c */
+	unsigned long long perf_count[PERF_EVENTS_MAX];
+	/* operations completed so far, published for the sampler */
+	unsigned long long ops __attribute__((aligned(64)));
 };
 
 struct workload {
@@ -39,6 +73,13 @@ struct workload {
 
 extern struct workload *all_workloads;
 
+/*
+ * KERNEL compiles a function for KERNEL_TARGET, the ISA of the workload
+ * defined by its file, while registration and init stay baseline x86-64
+ * and can run on any CPU
+ */
+#define KERNEL __attribute__((target(KERNEL_TARGET)))
+
 extern struct workload *register_GETCPU(void);
 extern struct workload *register_RDTSC(void);
 extern struct workload *register_AVX(void);
@@ -50,46 +91,228 @@ extern struct workload *register_DOTPROD(void);
 extern struct workload *register_PAUSE(void);
 extern struct workload *register_TPAUSE(void);
 extern struct workload *register_UMWAIT(void);
+extern struct workload *register_UMWAIT_LAT(void);
 extern struct workload *register_FP64(void);
 extern struct workload *register_SSE(void);
 extern struct workload *register_MEM(void);
 extern struct workload *register_memcpy(void);
 extern struct workload *register_AMX(void);
+extern struct workload *register_COPY_AVX2(void);
+extern struct workload *register_COPY_AVX512(void);
+extern struct workload *register_COPY_NT(void);
+extern struct workload *register_COPY_NT512(void);
+extern struct workload *register_REP_MOVSB(void);
+extern struct workload *register_AMX_GEMM_INT8(void);
+extern struct workload *register_AMX_GEMM_BF16(void);
+extern struct workload *register_AMX_COLD(void);
+extern struct workload *register_STREAM_SSE(void);
+extern struct workload *register_VNNI_PEAK(void);
+extern struct workload *register_VNNI512_PEAK(void);
+extern struct workload *register_DOTPROD_PEAK(void);
+extern struct workload *register_STREAM_AVX2(void);
+extern struct workload *register_STREAM_AVX512(void);
 
 extern unsigned int SIZE_1GB;
+extern int gemm_m, gemm_n, gemm_k;
+extern int stop_workers;
+extern double tsc_per_sec;
+extern int trial_count;
+
+const char *break_reason_name(int reason);
+
+/*
+ * Log-linear histogram: values below HIST_SUB_BUCKETS are exact, above
+ * that every power of two is split into HIST_SUB_BUCKETS linear buckets.
+ * A histogram has a single writer and is merged once the writer is done.
+ */
+#define HIST_SUB_BITS		4
+#define HIST_SUB_BUCKETS	(1 << HIST_SUB_BITS)
+#define HIST_BUCKETS		((64 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+struct histogram {
+	unsigned long long count;
+	unsigned long long sum;
+	unsigned long long min;
+	unsigned long long max;
+	unsigned long long buckets[HIST_BUCKETS];
+} __attribute__((aligned(64)));
+
+static inline void hist_add(struct histogram *h, unsigned long long v)
+{
+	int idx, msb;
+
+	if (v < HIST_SUB_BUCKETS) {
+		idx = v;
+	} else {
+		msb = 63 - __builtin_clzll(v);
+		idx = (msb - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS +
+		      ((v >> (msb - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1));
+	}
+
+	h->buckets[idx]++;
+	if (!h->count || v < h->min)
+		h->min = v;
+	if (v > h->max)
+		h->max = v;
+	h->count++;
+	h->sum += v;
+}
+
+/* stats.c */
+void trial_summarize(double *values, int n, struct trial_summary *ts);
+void hist_merge(struct histogram *dst, const struct histogram *src);
+unsigned long long hist_percentile(const struct histogram *h, double pct);
+void hist_print(const char *label, const struct histogram *h);
+
+/* alloc.c */
+enum {
+	ALLOC_MALLOC,
+	ALLOC_4K,
+	ALLOC_THP,
+	ALLOC_2M,
+	ALLOC_1G,
+};
+
+extern int alloc_policy;
+extern int alloc_populate;
+int parse_alloc_policy(const char *name);
+void *alloc_buffer(size_t bytes);
+void free_buffer(void *p, size_t bytes);
+
+/* perf.c */
+struct perf_event_mmap_page;
+
+struct perf_set {
+	int fd[PERF_EVENTS_MAX];
+	struct perf_event_mmap_page *page[PERF_EVENTS_MAX];
+	unsigned long long start[PERF_EVENTS_MAX];
+};
+
+extern int perf_enabled;
+extern int perf_nr_events;
+int parse_perf_raw(const char *list);
+const char *perf_event_name(int idx);
+int perf_open(struct perf_set *ps);
+void perf_begin(struct perf_set *ps);
+void perf_end(struct perf_set *ps, unsigned long long *counts);
+void perf_check(struct perf_set *ps, struct work_instance *wi);
+void perf_close(struct perf_set *ps);
+void perf_print(struct work_instance *wi);
+
+/* STREAM kernels of run_stream.c, selected by --stream_kernel */
+enum {
+	STREAM_READ,		/* sum a[] */
+	STREAM_WRITE,		/* a[] = s */
+	STREAM_COPY,		/* c[] = a[] */
+	STREAM_SCALE,		/* b[] = s * c[] */
+	STREAM_ADD,		/* c[] = a[] + b[] */
+	STREAM_TRIAD,		/* a[] = b[] + s * c[] */
+};
+
+extern int stream_kernel;
+
+/* independent accumulator chains of the *_PEAK workloads, see run_peak.c */
+#define ACCUMULATORS_MIN	4
+#define ACCUMULATORS_MAX	12
+extern int accumulators;
+
+/* UMWAIT_LAT: 0 waits in C0.2, 1 in C0.1, as the UMWAIT control operand */
+extern int umwait_state;
+extern int umwait_waker_cpu;
+extern long umwait_max_time;
+
+/* arrays a STREAM kernel reads or writes, counted as bytes moved */
+static inline int stream_arrays(int kernel)
+{
+	switch (kernel) {
+	case STREAM_READ:
+	case STREAM_WRITE:
+		return 1;
+	case STREAM_COPY:
+	case STREAM_SCALE:
+		return 2;
+	default:
+		return 3;
+	}
+}
+
+/* trace.c */
+enum {
+	TRACE_INIT_BEGIN,
+	TRACE_INIT_END,
+	TRACE_RUN_BEGIN,
+	TRACE_RUN_END,
+	TRACE_BREAK_BEGIN,	/* arg is the break reason */
+	TRACE_BREAK_END,
+	TRACE_CLEANUP_BEGIN,
+	TRACE_CLEANUP_END,
+	TRACE_SIGNAL,
+	TRACE_MIGRATE,		/* arg is the previous CPU */
+};
+
+struct trace_record {
+	unsigned long long tsc;
+	unsigned short event;
+	unsigned short cpu;
+	unsigned int arg;
+};
+
+extern int trace_enabled;
+void trace_open(int nr_threads);
+void trace_thread_start(struct work_instance *wi);
+void trace_event(int event, unsigned int arg);
+void trace_dump(const char *path);
+void trace_convert(const char *in_path, const char *out_path);
+
+/* result.c */
+int result_open(const char *path, const char *format);
+void result_write(struct work_instance *wi);
+void result_close(void);
 
 #ifdef YOGINI_MAIN
+/*
+ * every workload the compiler has intrinsics for is built into every
+ * binary, its KERNEL functions for its own ISA, and its register routine
+ * returns NULL unless the CPU and the OS (XCR0) support it
+ */
 struct workload *(*all_register_routines[]) () = {
-#if MAVX_ENABLED || CMAKE_FLAG
 	register_AVX,
-#endif
-#if MAVX2_ENABLED || CMAKE_FLAG
 	register_AVX2,
-#endif
-#if MAVX512F_ENABLED || CMAKE_FLAG
+#if __GNUC__ >= 11
 	register_AVX512,
 #endif
-#if MVNNI512_ENABLED || CMAKE_FLAG
+#if __GNUC__ >= 9
 	register_VNNI512,
+	register_VNNI512_PEAK,
 #endif
-#if MVNNI_ENABLED || CMAKE_FLAG
+#if __GNUC__ >= 11
 	register_VNNI,
+	register_VNNI_PEAK,
 #endif
 	register_DOTPROD,
+	register_DOTPROD_PEAK,
 	register_PAUSE,
 #if __GNUC__ >= 9
 	register_TPAUSE,
 	register_UMWAIT,
+	register_UMWAIT_LAT,
 #endif
 	register_RDTSC,
-#if MSSE_ENABLED || CMAKE_FLAG
 	register_SSE,
-#endif
 	register_MEM,
 	register_memcpy,
-#if MAMX_ENABLED || CMAKE_FLAG
+	register_REP_MOVSB,
+	register_COPY_NT,
+	register_COPY_AVX2,
+	register_COPY_AVX512,
+	register_COPY_NT512,
 	register_AMX,
-#endif
+	register_AMX_GEMM_INT8,
+	register_AMX_GEMM_BF16,
+	register_AMX_COLD,
+	register_STREAM_SSE,
+	register_STREAM_AVX2,
+	register_STREAM_AVX512,
 	NULL
 };
 #endif
@@ -114,13 +337,34 @@ static inline unsigned long long rdtsc(void)
 	return low | ((unsigned long long)high) << 32;
 }
 
+/*
+ * worker_progress()
+ * publish the operations completed by this worker so far
+ * return non-zero when a time-bounded run has expired
+ */
+static inline int worker_progress(struct work_instance *wi, unsigned long long ops)
+{
+	__atomic_store_n(&wi->ops, ops, __ATOMIC_RELAXED);
+	return __atomic_load_n(&stop_workers, __ATOMIC_RELAXED);
+}
+
 void clflush_range(void *address, size_t size);
 extern int clfulsh;
+/* features usable by yogini: enumerated by CPUID and enabled in XCR0 */
 struct cpuid {
+	unsigned int sse4_2;
+	unsigned int avx;
+	unsigned int avx2;
+	unsigned int fma;
 	unsigned int avx512f;
+	unsigned int avx512bw;
+	unsigned int avx512_bf16;
 	unsigned int vnni512;
 	unsigned int avx2vnni;
 	unsigned int tpause;
+	unsigned int amx_tile;
+	unsigned int amx_int8;
+	unsigned int amx_bf16;
 };
 
 extern struct cpuid cpuid;